@@ -1,5 +1,9 @@
 #pragma once
 
+#include <atomic>
+#include <thread>
+
+#include <combining_trigger.hpp>
 #include <xcs.hpp>
 
 namespace xcs_rc {
@@ -8,31 +12,134 @@ namespace xcs_rc {
 
 class XCSLearner {
 	public:
-		XCSLearner(ActionSpace as) {
+		/// Learners with the same seed and stream make the same decisions.
+		/// Give learners that run side by side different streams.
+		XCSLearner(ActionSpace as, uint64_t seed = 0, uint64_t stream = 0) : rng(seed, stream) {
 			action_space = as;
+			pop.reserve(max_pop_size);
 		}
+		XCSLearner(const XCSLearner&) = delete;
+		XCSLearner& operator=(const XCSLearner&) = delete;
+		~XCSLearner();
+
+		Action take_action(const std::string& state, ActionMode mode);
+
+		/// Takes an action for a real valued state of len values
+		Action take_action(const double* state, size_t len, ActionMode mode);
+		Action take_action(const float* state, size_t len, ActionMode mode);
+
+		/// Takes an action for a binary state of len bits, packed into 64
+		/// bit words with bit k of state[k / 64] holding position k
+		Action take_action(const uint64_t* state, size_t len, ActionMode mode);
+
+		/// Rewards the action taken for the state of the last take_action
+		void update_with_reward(const Action act, double reward);
 
-		Action take_action(std::string state, ActionMode mode);
-		void update_with_reward(std::string state, const Action act, double reward);
+		/// Same as above, state must be the one passed to take_action
+		void update_with_reward(const std::string& state, const Action act, double reward);
 
 		/// Returns read only reference to population
-		const ClassifierSet& get_population() const {
+		const Population& get_population() const {
 			return this->pop;
 		}
+		/// Totals over the population, kept up to date by it
+		size_t total_numerosity() const { return pop.total_numerosity(); }
+		double total_fitness() const { return pop.total_fitness(); }
+		size_t experienced_classifiers() const { return pop.experienced(); }
+		size_t total_experience() const { return pop.total_experience(); }
+
+		/// Also sizes the population storage, so that a learner at its
+		/// population limit inserts classifiers without allocating
 		void set_maxpopsize(size_t size) {
 			max_pop_size = size;
+			pop.reserve(max_pop_size);
+		}
+		/// Matches binary inputs through a per-bit inverted index instead of
+		/// scanning every classifier
+		void set_match_index(bool enabled) {
+			pop.set_match_index(enabled);
+		}
+
+		/// Remembers between combining passes which classifiers disproved a
+		/// pair, so that only pairs affected by changes are examined again.
+		/// Does not change the result.
+		void set_incremental_combining(bool enabled) {
+			finish_combining();
+			incremental_combining = enabled;
+			disprovals.clear();
+		}
+		/// Combines a copy of the population on a thread of its own while
+		/// trials go on with the population. The first time combining is due
+		/// after the pass has finished, its result replaces the population,
+		/// with the changes made in the meantime replayed onto it. As that
+		/// depends on the timing of the thread, runs are not reproducible.
+		void set_background_combining(bool enabled) {
+			finish_combining();
+			background_combining = enabled;
+		}
+		/// Spreads combining over the trials instead: once due, a pass over a
+		/// copy of the population examines at most budget candidate pairs per
+		/// trial, and its result replaces the population when it is complete.
+		/// 0 combines at once. Runs stay reproducible.
+		void set_combining_budget(size_t budget) {
+			combining_budget = budget;
+		}
+
+		/// Restarts the random number generator of the learner
+		void seed(uint64_t seed, uint64_t stream = 0) {
+			rng.seed(seed, stream);
 		}
 
 		size_t combining_period = 0;
+		/// Combines whenever combining_trigger finds a pass worth it instead
+		/// of every combining_period trials
+		bool adaptive_combining = false;
+		CombiningTrigger combining_trigger;
+		/// Threads combining the actions in parallel, 0 means one per core
+		unsigned int combining_threads = 0;
 		size_t trials = 0;
 		void reset();
 	private:
+		Action take_action(ActionMode mode);
+
+		/// Starts combining a copy of the population in the background
+		void start_combining();
+		/// Completes the pass under way, if any, and publishes its result
+		void finish_combining();
+		/// Goes on with the pass spread over the trials
+		void advance_combining(size_t budget);
+		bool combining_due() const;
+		vector<DisprovalCache>* combining_caches() {
+			return incremental_combining ? &disprovals : nullptr;
+		}
+
 		int input_mode;
-		ClassifierSet pop;
-		ClassifierSet match_set; // possible to remove?
-		ClassifierSet action_set; // possible to remove?
+		Input input; // state of the last take_action
+		Population pop;
+		// reused between trials, index into pop
+		ClassifierSet match_set;
+		PredictionArray prediction_array;
+		ClassifierSet action_set;
+		uint64_t action_set_generation = 0; // of pop when action_set was generated
+		ActionSetView action_view; // for update_set
 		ActionSpace action_space;
 		size_t max_pop_size = MAX_POP_SIZE;
+		Rng rng;
+
+		bool incremental_combining = true;
+		vector<DisprovalCache> disprovals; // per action, for combine_set
+		CombiningBuffers combining_buffers; // of combine_set, reused between passes
+
+		bool background_combining = false;
+		std::thread combiner; // runs the background pass, if any
+		vector<DisprovalCache> combiner_disprovals; // disprovals, while the background pass runs
+		std::atomic<bool> combining_done{false};
+
+		size_t combining_budget = 0;
+		CombiningPass combining_pass; // spread over the trials
+		Population snapshot; // pop when the background pass started
+		Population combined; // combined by the background pass
+		ReconcileScratch reconcile_scratch; // for the background pass
 
 		bool dirty = false; // was MODIFIED
 };
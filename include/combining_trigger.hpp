@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+
+#include "population.hpp"
+
+/// Decides when a combining pass is worth running, from how the population
+/// has changed since the last one instead of every combining_period trials.
+///
+/// The trials between passes follow the yield of the passes: they halve
+/// after a pass that merged at least target_yield of the classifiers and
+/// double after one that merged less, within [min_interval, max_interval].
+/// So passes get rare once there is little left to merge.
+///
+/// Combining only merges classifiers of at least MIN_EXP experience. Once
+/// burst classifiers have reached it since the last pass started, a pass is
+/// due early, after min_interval trials. The closer the total numerosity is to
+/// the population limit, the fewer it takes, so that combining keeps up with
+/// covering bursts before deletion has to make room.
+///
+/// A pass examines about E^2 / 2 candidate pairs per action for E
+/// experienced classifiers of the action. Given a cost ceiling, the next pass
+/// waits until the estimated cost of the last one spread over the trials
+/// since is below it.
+///
+/// Asking the trigger is O(1), so it can be asked every trial.
+class CombiningTrigger {
+  public:
+	/// Bounds of the trials between passes
+	size_t min_interval = 50;
+	size_t max_interval = 3200;
+
+	/// Fraction of the classifiers a pass has to merge for the next one to
+	/// come sooner
+	double target_yield = 0.05;
+
+	/// Classifiers reaching MIN_EXP that make a pass due early, with the
+	/// population still empty
+	double burst = 64;
+
+	/// Candidate pairs per trial that combining may examine on average, 0
+	/// for no limit
+	double pairs_per_trial = 0;
+
+	/// Returns true if a pass is due at trial trials
+	bool due(const Population& pop, size_t max_pop_size, size_t trials) const;
+
+	/// Records that n classifiers have reached MIN_EXP
+	void experienced(size_t n) { fresh_ += n; }
+
+	/// Records that a pass over pop with the given number of actions starts
+	/// at trial trials
+	void started(const Population& pop, size_t actions, size_t trials);
+
+	/// Records that a pass has replaced a population of before classifiers
+	/// by one of after classifiers
+	void finished(size_t before, size_t after);
+
+	/// Forgets all passes
+	void reset();
+
+  private:
+	size_t interval_ = 0; // trials between passes, at least min_interval
+	size_t fresh_ = 0; // classifiers that reached it since the last pass started
+	size_t last_ = 0; // trial the last pass started at
+	double cost_ = 0; // estimated candidate pairs it examines
+};
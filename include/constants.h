@@ -38,8 +38,9 @@ const double ALPHA = 0.1;
 const double BETA = 0.15;
 const double EPSILON_ZERO = 0.01;
 
-/// Used for fitness update.
-const double POWER_PARAMETER = 5.0;
+/// Used for fitness update. Constexpr so that a whole exponent is raised
+/// by multiplications fixed at compile time.
+constexpr double POWER_PARAMETER = 5.0;
 
 // Larger values may be better for some problems.
 const unsigned SUBSUMPTION_THRESHOLD = 50;
@@ -49,4 +50,6 @@ const int MIN_EXP = 1;
 const int MAX_DISP_RATE = 2;
 const double PRED_TOL = 10;
 const double PRED_ERR_TOL = 260;
+/// Combining only starts another thread for every this many classifiers
+const unsigned COMBINING_CLASSIFIERS_PER_THREAD = 64;
 
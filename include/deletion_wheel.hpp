@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+using std::vector;
+
+/// Roulette wheel over the deletion votes of a population.
+///
+/// The deletion vote of a classifier with action set size estimate as,
+/// numerosity num and fitness f is as * num, scaled by mean / (f / num) if the
+/// classifier is inexperienced or its fitness per micro-classifier f / num is
+/// at least DELTA_DELETION times the mean fitness of the population.
+///
+/// The wheel keeps both variants in a sum tree: a for the classifiers whose
+/// vote is scaled by the mean, b for the others. The total vote is then
+/// mean * a + b and a victim is found by descending the tree in O(log N).
+/// Every node also keeps the lowest f / num of the experienced classifiers
+/// below it on side a and the highest of those on side b. When the mean
+/// fitness changes, only the paths to the classifiers crossing the threshold
+/// are descended and moved between a and b, so every change costs O(log N)
+/// per classifier it affects.
+///
+/// The wheel mirrors the order of the population it belongs to.
+class DeletionWheel {
+  public:
+	size_t size() const { return size_; }
+
+	/// Sum of the fitness of all classifiers
+	double total_fitness() const { return tree_.empty() ? 0 : tree_[1].f; }
+
+	/// Sum of the numerosity of all classifiers
+	double total_numerosity() const { return tree_.empty() ? 0 : tree_[1].n; }
+
+	/// Number of entries currently allocated for the wheel
+	size_t allocated_entries() const;
+
+	/// Empties the wheel, keeping the allocated memory
+	void reset();
+
+	/// Makes room for n classifiers
+	void reserve(size_t n);
+
+	/// Refills the wheel from the parameter columns of n classifiers
+	void assign(const double* actionset_size, const unsigned int* numerosity, const double* fitness,
+	            const unsigned int* experience, size_t n);
+
+	/// Appends a classifier
+	void push_back(double actionset_size, unsigned int numerosity, double fitness, unsigned int experience);
+
+	/// Replaces the parameters of the classifier at index i
+	void update(size_t i, double actionset_size, unsigned int numerosity, double fitness, unsigned int experience);
+
+	/// Removes the classifier at index i by moving the last one into its
+	/// place, in O(log N)
+	void swap_erase(size_t i);
+
+	/// Returns the sum of all deletion votes for the current mean fitness
+	double vote_sum();
+
+	/// Returns the first index at which the running sum of the votes exceeds
+	/// choice, or size() if there is none. Valid after vote_sum().
+	size_t find(double choice) const;
+
+  private:
+	struct Node {
+		double a;
+		double b;
+		double f;
+		double n;
+		double lowest_a; // f / num of experienced classifiers, +inf or -inf if none
+		double highest_b;
+	};
+
+	size_t size_ = 0;
+	size_t leaves_ = 0;
+	double mean_ = 0;
+	double threshold_ = 0;
+
+	/// as * num and f / num of every classifier
+	vector<double> vote_;
+	vector<double> ratio_;
+	vector<double> fitness_;
+	vector<double> numerosity_;
+	vector<char> ranked_; // experienced, so that the threshold applies
+
+	vector<Node> tree_;
+
+	void set(size_t i, double actionset_size, unsigned int numerosity, double fitness, unsigned int experience);
+	Node leaf(size_t i) const;
+	static Node join(const Node& l, const Node& r);
+	void fix_path(size_t i);
+	void build_tree();
+
+	/// Moves the classifiers below node that are on the wrong side of the
+	/// threshold
+	void reclassify(size_t node);
+};
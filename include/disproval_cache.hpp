@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "population.hpp"
+
+using std::vector;
+
+/// Remembers which classifiers disproved the candidate pairs of one action
+/// the last time combining examined them.
+///
+/// Whether a pair is disproved depends on the conditions, predictions and
+/// numerosities of both candidates and on the prediction, experience and
+/// condition of every other classifier of the action. Conditions never
+/// change and the rest moves the stamp of a classifier, so the disprovers of
+/// a pair whose candidates are unchanged since it was stored are the stored
+/// ones that are unchanged as well, plus whichever of the classifiers
+/// changed since then disprove it now. Only the latter have to be examined.
+///
+/// Pairs and disprovers are kept by classifier id, so the cache survives
+/// sorting and erasing. It belongs to a single population and its copies.
+///
+/// Pairs and ids are found through open addressing tables in flat vectors,
+/// which only allocate when they grow, and the disprovers of all pairs share
+/// one vector.
+class DisprovalCache {
+  public:
+	/// Number of remembered pairs
+	size_t size() const { return size_; }
+
+	/// Forgets all pairs
+	void clear();
+
+	/// Prepares a combining pass over pop
+	void begin(const Population& pop);
+
+	/// Forgets the index of a classifier combining is about to erase
+	void erase(uint64_t id);
+
+	/// Follows pop after combining has moved classifier cl to its index,
+	/// inserted it or changed it
+	void place(const Population& pop, size_t cl);
+
+	/// Returns false if the pair (i, j) has to be examined in full. Otherwise
+	/// appends the remembered disprovers that are unchanged to known and the
+	/// classifiers that changed since the pair was stored to changed.
+	bool lookup(const Population& pop, size_t i, size_t j, ClassifierSet& known, ClassifierSet& changed);
+
+	/// Remembers the disprovers of the pair (i, j)
+	void store(const Population& pop, size_t i, size_t j, const ClassifierSet& disprovers);
+
+	/// Forgets the pairs that the pass has not looked at
+	void end();
+
+  private:
+	struct Entry {
+		uint64_t first; // ids of the pair, the smaller first, 0 for a free slot
+		uint64_t second;
+		uint64_t clock; // of the population when the disprovers were stored
+		size_t begin; // disprovers_[begin, begin + count)
+		size_t count;
+		bool used;
+	};
+
+	struct Slot {
+		uint64_t id; // 0 for a free slot
+		size_t index;
+	};
+
+	/// Returns the entry of the pair (i, j), or nullptr
+	Entry* find(const Population& pop, size_t i, size_t j);
+
+	/// Returns the entry of the pair of ids (first, second), adding it if needed
+	Entry& insert(uint64_t first, uint64_t second);
+
+	/// Index of an id, or pop.size() if the classifier no longer exists
+	size_t index_of(const Population& pop, uint64_t id) const;
+
+	/// Sets the index of an id, adding it if needed
+	void set_index(uint64_t id, size_t cl);
+
+	size_t size_ = 0;
+	vector<Entry> pairs_;
+	vector<uint64_t> disprovers_;
+
+	/// Spare storage for end() to move the pairs that are kept to
+	vector<Entry> kept_pairs_;
+	vector<uint64_t> kept_disprovers_;
+
+	/// Population index of every id and (stamp, id) of every change, sorted,
+	/// for the duration of a pass
+	size_t ids_ = 0;
+	vector<Slot> index_;
+	vector<std::pair<uint64_t, uint64_t>> changes_;
+};
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/// Hash of a classifier id for open addressing tables, the finalizer of
+/// splitmix64
+inline size_t
+hash_id(uint64_t id) {
+	id = (id ^ (id >> 30)) * 0xbf58476d1ce4e5b9ull;
+	id = (id ^ (id >> 27)) * 0x94d049bb133111ebull;
+	return id ^ (id >> 31);
+}
+
+/// Hash of a pair of classifier ids
+inline size_t
+hash_pair(uint64_t first, uint64_t second) {
+	return hash_id(first * 0x9e3779b97f4a7c15ull ^ second);
+}
+
+/// Smallest power of two that keeps a table for n entries at most half full
+inline size_t
+table_size(size_t n) {
+	size_t size = 16;
+	while (size < 2 * n)
+		size *= 2;
+	return size;
+}
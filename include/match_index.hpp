@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "xcs_types.hpp"
+
+using std::vector;
+
+/// Inverted index over the conditions of a binary population.
+///
+/// For every input position k and bit value v it keeps a bitset over the
+/// classifier indices whose condition accepts v at position k. The match set
+/// of an input is the intersection of one bitset per position, which costs
+/// len * size() / 64 word operations no matter how the conditions look.
+///
+/// The index mirrors the order of the population it belongs to.
+class MatchIndex {
+  public:
+	size_t size() const { return size_; }
+
+	/// Number of conditions the index holds without growing
+	size_t capacity() const { return 64 * words_; }
+
+	/// Number of words currently allocated for the bitsets
+	size_t allocated_words() const { return bits_.capacity(); }
+
+	/// Empties the index and prepares it for conditions of len positions.
+	/// Keeps the allocated memory.
+	void reset(size_t len);
+
+	/// Makes room for n conditions
+	void reserve(size_t n);
+
+	/// Appends the condition given by care and value masks
+	void push_back(const uint64_t* care, const uint64_t* value);
+
+	/// Removes the condition at index i by moving the last one into its place
+	void swap_erase(size_t i);
+
+	/// Appends the indices of all conditions matching the packed input to out
+	void match(const uint64_t* input, ClassifierSet& out) const;
+
+  private:
+	uint64_t* bitset(size_t k, unsigned v) { return bits_.data() + (2 * k + v) * words_; }
+	const uint64_t* bitset(size_t k, unsigned v) const { return bits_.data() + (2 * k + v) * words_; }
+
+	/// Widens every bitset to the given number of words
+	void grow(size_t words);
+
+	size_t len_ = 0;
+	size_t size_ = 0;
+	size_t words_ = 0; // words per bitset
+
+	vector<uint64_t> bits_;
+	mutable vector<uint64_t> scratch_;
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+
+#include "xcs_types.hpp"
+
+/// Kernels that test the deinterleaved bounds of a whole population against
+/// one real valued input.
+///
+/// The bounds of classifier c are the len doubles starting at lower + c * len
+/// and upper + c * len, as laid out by Population. Every kernel appends the
+/// indices of all matching classifiers in [0, n) to out in ascending order.
+using BoundsMatchKernel = void (*)(const double* lower, const double* upper, size_t n, size_t len,
+                                   const double* input, ClassifierSet& out);
+
+enum class MatchPath {
+	Scalar,
+	AVX2,
+	AVX512,
+};
+
+void
+match_bounds_scalar(const double* lower, const double* upper, size_t n, size_t len, const double* input,
+                    ClassifierSet& out);
+
+/// Tests four dimensions per instruction
+void
+match_bounds_avx2(const double* lower, const double* upper, size_t n, size_t len, const double* input,
+                  ClassifierSet& out);
+
+/// Tests eight dimensions per instruction
+void
+match_bounds_avx512(const double* lower, const double* upper, size_t n, size_t len, const double* input,
+                    ClassifierSet& out);
+
+/// Returns true if the CPU this runs on can execute the given path
+bool
+match_path_supported(MatchPath path);
+
+/// Returns the fastest path supported by the CPU
+MatchPath
+best_match_path();
+
+/// Returns the kernel implementing a path
+BoundsMatchKernel
+match_kernel(MatchPath path);
+
+/// Matches with the fastest kernel supported by the CPU, chosen once at runtime
+void
+match_bounds(const double* lower, const double* upper, size_t n, size_t len, const double* input, ClassifierSet& out);
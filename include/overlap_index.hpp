@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "population.hpp"
+
+using std::vector;
+
+/// Bounding volume hierarchy over the real valued conditions of a set of
+/// classifiers.
+///
+/// Each node holds the bounding box of the conditions below it, so a query
+/// only descends into subtrees whose box overlaps the queried condition.
+/// The index copies the bounds it is built from and refers to classifiers by
+/// their population index.
+///
+/// Classifiers inserted after the last build are kept in a linear tail and
+/// erased ones are only marked dead. Once either grows too large, the tree is
+/// rebuilt from the live entries.
+///
+/// When the conditions are so wide that a query looks at more than half as
+/// many boxes and conditions as there are entries, the following queries
+/// scan the entries instead and only now and then probe the tree again.
+class OverlapIndex {
+  public:
+	/// Number of live entries
+	size_t size() const { return live_; }
+
+	/// Rebuilds the index over the given classifiers of a real valued population
+	void assign(const Population& pop, const ClassifierSet& classifiers);
+
+	/// Adds the classifier at index cl of the population
+	void insert(const Population& pop, size_t cl);
+
+	/// Removes the given sorted classifiers, which delete_classifier has
+	/// just deleted from the highest index down from a population of the
+	/// given size, and follows the ones moved into their indices
+	void swap_erase(const ClassifierSet& victims, size_t size);
+
+	/// Appends the indices of all classifiers whose bounds overlap the given
+	/// bounds to out
+	void query(const double* lower, const double* upper, ClassifierSet& out) const;
+
+  private:
+	struct Node {
+		size_t begin; // range of order_ covered by the node
+		size_t end;
+		size_t left; // children, 0 for leaves
+		size_t right;
+	};
+
+	const double* lower(size_t e) const { return lower_.data() + e * len_; }
+	const double* upper(size_t e) const { return upper_.data() + e * len_; }
+
+	void push_entry(const double* lower, const double* upper, size_t cl);
+	void rebuild();
+	size_t build(size_t begin, size_t end);
+
+	size_t len_ = 0;
+	size_t live_ = 0;
+	size_t built_ = 0; // entries covered by the tree, the rest form the tail
+
+	/// Bounds, population index and liveness of every entry
+	vector<double> lower_;
+	vector<double> upper_;
+	vector<size_t> cl_;
+	vector<char> alive_;
+
+	/// Entries in tree order and the nodes with their boxes
+	vector<size_t> order_;
+	vector<Node> nodes_;
+	vector<double> node_lower_;
+	vector<double> node_upper_;
+
+	mutable vector<size_t> stack_;
+	mutable size_t scans_left_ = 0;
+};
@@ -0,0 +1,245 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "deletion_wheel.hpp"
+#include "match_index.hpp"
+#include "rule_index.hpp"
+#include "xcs_types.hpp"
+
+using std::vector;
+
+/// The population [P] stored as a structure of arrays.
+///
+/// Every classifier parameter lives in its own contiguous column and
+/// classifiers are addressed by their index. The condition of classifier i
+/// is kept deinterleaved: its lower bounds are cond_len() doubles starting
+/// at lower(i), its upper bounds the same amount starting at upper(i).
+///
+/// Binary populations store conditions as ternary bit masks instead: bit k of
+/// care(i) is set if position k must match, and bit k of value(i) holds the
+/// expected input bit. Both span cond_words() 64 bit words.
+///
+/// Indices are only stable until the next erase(), swap_erase(),
+/// erase_inexperienced() or permute(). Sets of indices can compare
+/// generation() to detect that they went stale.
+///
+/// A binary population can additionally keep a MatchIndex of its conditions,
+/// which every modifying member keeps in sync. The same holds for the
+/// RuleIndex behind find_rule(), the DeletionWheel over the deletion votes,
+/// the totals of numerosity, fitness and experience and the stamps telling
+/// what changed since a clock(), which is why prediction, fitness,
+/// experience, action set size and numerosity can only be changed through
+/// setters.
+class Population {
+  public:
+	size_t size() const { return act_.size(); }
+	bool empty() const { return act_.empty(); }
+
+	/// Number of input dimensions, 0 until the first classifier is inserted
+	size_t cond_len() const { return len_; }
+
+	/// Number of 64 bit words of a binary condition
+	size_t cond_words() const { return words_; }
+
+	/// Changes whenever the index of an existing classifier may have changed
+	uint64_t generation() const { return generation_; }
+
+	/// Identifies a classifier for as long as it exists, also in copies of the
+	/// population. Unique within the process.
+	uint64_t id(size_t i) const { return id_[i]; }
+
+	/// Value of clock() when classifier i was inserted or last changed its
+	/// prediction, its numerosity or whether its experience reaches 1 and
+	/// MIN_EXP, which is everything that decides how it combines
+	uint64_t stamp(size_t i) const { return stamp_[i]; }
+
+	/// Advances with every stamped change and never goes back
+	uint64_t clock() const { return clock_; }
+
+	/// Stamps classifier i as changed
+	void touch(size_t i) { stamp_[i] = ++clock_; }
+
+	/// Number the condition of classifier i is ordered by, computed on
+	/// insertion. It packs the start of the condition, most significant
+	/// first: the first 32 positions of a binary condition in 2 bits each,
+	/// valued 0, 1 and 2 for '0', '1' and '#', or the bounds of the first 4
+	/// dimensions of a real valued one, quantised over [0, 1] to 8 bits each.
+	/// Conditions that only differ further on share a key.
+	uint64_t cond_key(size_t i) const { return cond_key_[i]; }
+
+	/// Returns true if conditions are stored as bit masks
+	bool binary() const { return binary_; }
+
+	/// Selects the condition layout. Only allowed on an empty population.
+	void set_binary(bool binary);
+
+	/// Enables or disables the inverted match index. The setting survives
+	/// clear() but only takes effect while the population is binary.
+	void set_match_index(bool enabled);
+
+	/// Returns the inverted match index, or nullptr if there is none
+	const MatchIndex* match_index() const { return indexed_ && binary_ ? &index_ : nullptr; }
+
+	/// Returns the roulette wheel over the deletion votes
+	DeletionWheel& deletion_wheel() { return wheel_; }
+
+	/// Sum of the numerosity of all classifiers
+	size_t total_numerosity() const { return total_numerosity_; }
+
+	/// Sum of the fitness of all classifiers
+	double total_fitness() const { return wheel_.total_fitness(); }
+
+	/// Number of classifiers with an experience above zero
+	size_t experienced() const { return experienced_; }
+
+	/// Sum of the experience of all classifiers
+	size_t total_experience() const { return total_experience_; }
+
+	/// Empties the population, keeping its storage for reuse
+	void clear();
+
+	/// Makes room for n classifiers, so that inserting up to n of them
+	/// does not allocate. On an empty population the conditions are sized
+	/// by the first insertion.
+	void reserve(size_t n);
+
+	/// Number of insertions that had to grow the storage of the population
+	size_t allocations() const { return allocations_; }
+
+	/// Appends a classifier and returns its index
+	size_t push_back(const Classifier& cl);
+
+	/// Appends a classifier whose condition accepts exactly the given input
+	/// and returns its index. Its parameters are those of a new Classifier.
+	size_t push_back(const Input& input, Action act);
+
+	/// Appends a copy of classifier i of another population with the same
+	/// condition layout and returns its index
+	size_t push_back(const Population& other, size_t i);
+
+	/// Removes the classifier at index i, keeping the order of the others.
+	/// Takes O(N), erase the classifiers in a batch or swap_erase() them
+	/// when removing several.
+	void erase(size_t i);
+
+	/// Removes the classifiers at the given indices, sorted ascending, in a
+	/// single pass, keeping the order of the others
+	void erase(const ClassifierSet& victims);
+
+	/// Removes the classifier at index i in O(1) by moving the last
+	/// classifier into its place
+	void swap_erase(size_t i);
+
+	/// Removes every classifier without experience in a single pass,
+	/// keeping the order of the others, and returns how many it removed
+	size_t erase_inexperienced();
+
+	/// Reorders the population so that the classifier previously at
+	/// order[k] ends up at index k
+	void permute(const vector<size_t>& order);
+
+	/// Returns a copy of the classifier at index i
+	Classifier get(size_t i) const;
+
+	/// Returns true if classifiers i and j have the same condition and action
+	bool same_rule(size_t i, size_t j) const;
+	bool same_rule(size_t i, const Rule& rule) const;
+
+	/// Returns the lowest index of a classifier with the given rule, or size()
+	/// if there is none. Expected O(1) through a hash index over the rules.
+	size_t find_rule(const Rule& rule) const;
+
+	const double* lower(size_t i) const { return lower_.data() + i * len_; }
+	const double* upper(size_t i) const { return upper_.data() + i * len_; }
+
+	const uint64_t* care(size_t i) const { return care_.data() + i * words_; }
+	const uint64_t* value(size_t i) const { return value_.data() + i * words_; }
+
+	Action act(size_t i) const { return act_[i]; }
+
+	double prediction(size_t i) const { return prediction_[i]; }
+	void set_prediction(size_t i, double prediction);
+
+	double prediction_error(size_t i) const { return prediction_error_[i]; }
+	double& prediction_error(size_t i) { return prediction_error_[i]; }
+
+	double fitness(size_t i) const { return fitness_[i]; }
+	void set_fitness(size_t i, double fitness);
+
+	unsigned int experience(size_t i) const { return experience_[i]; }
+	void set_experience(size_t i, unsigned int experience);
+
+	double actionset_size(size_t i) const { return actionset_size_[i]; }
+	void set_actionset_size(size_t i, double actionset_size);
+
+	unsigned int numerosity(size_t i) const { return numerosity_[i]; }
+	void set_numerosity(size_t i, unsigned int numerosity);
+
+	/// Sets everything updating an action set changes of classifier i at
+	/// once, updating the stamp, the totals and the wheel only once
+	void set_learned(size_t i, unsigned int experience, double prediction, double prediction_error,
+	                 double actionset_size, double fitness);
+
+	unsigned int disproving(size_t i) const { return disproving_[i]; }
+	unsigned int& disproving(size_t i) { return disproving_[i]; }
+
+	bool disproves(size_t i) const { return disproves_[i] != 0; }
+	void set_disproves(size_t i, bool d) { disproves_[i] = d; }
+
+  private:
+	size_t len_ = 0;
+	size_t words_ = 0;
+	bool binary_ = false;
+	bool indexed_ = false;
+	size_t allocations_ = 0;
+	uint64_t generation_ = 0;
+	size_t total_numerosity_ = 0;
+	size_t experienced_ = 0;
+	size_t total_experience_ = 0;
+	uint64_t clock_ = 0;
+
+	void rebuild_index();
+	uint64_t condition_key(size_t i) const;
+	uint64_t rule_hash(size_t i) const;
+	void rebuild_rules();
+	/// Keeps the classifiers in kept_, in their order, and rebuilds what
+	/// indexes them
+	void compact();
+	void update_wheel(size_t i);
+	void add_to_totals(size_t i);
+	void remove_from_totals(size_t i);
+
+	/// Prepares appending a classifier with a condition of len dimensions
+	void begin_push(size_t len);
+	void push_parameters(const Classifier& cl);
+	void end_push();
+	size_t storage_capacity() const;
+
+	vector<double> lower_;
+	vector<double> upper_;
+	vector<uint64_t> care_;
+	vector<uint64_t> value_;
+	vector<Action> act_;
+	vector<double> prediction_;
+	vector<double> prediction_error_;
+	vector<double> fitness_;
+	vector<unsigned int> experience_;
+	vector<double> actionset_size_;
+	vector<unsigned int> numerosity_;
+	vector<unsigned int> disproving_;
+	vector<char> disproves_;
+	vector<uint64_t> id_;
+	vector<uint64_t> stamp_;
+	vector<uint64_t> cond_key_;
+	vector<uint64_t> rule_hash_;
+
+	MatchIndex index_;
+	RuleIndex rules_;
+	DeletionWheel wheel_;
+
+	vector<size_t> kept_; // classifiers compact() keeps
+	vector<char> spare_; // scratch storage of permute
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using std::vector;
+
+/// Candidate pairs that combining has found disproved while combining the
+/// classifiers of one action, each with one of its disprovers as a witness.
+///
+/// Combining only erases classifiers and adds merged ones, so a pair stays
+/// disproved as long as its candidates and its witness are left, and only
+/// the classifiers added since it was examined can disprove it as well.
+///
+/// Pairs are kept by classifier id in an open addressing table in a flat
+/// vector, which only allocates when it grows. A second table chains the
+/// pairs of each witness, so that erasing a witness finds the pairs that
+/// may no longer be disproved.
+class RejectedPairs {
+  public:
+	struct Entry {
+		uint64_t first; // ids of the pair, the smaller first, 0 for a free slot
+		uint64_t second;
+		uint64_t witness; // id of a disprover
+		size_t added; // classifiers added by combining when the pair was examined
+	};
+
+	/// Number of remembered pairs
+	size_t size() const { return size_; }
+
+	/// Forgets all pairs, keeping the allocated memory
+	void clear();
+
+	/// Returns the entry of the pair of ids (a, b), or nullptr
+	Entry* find(uint64_t a, uint64_t b);
+
+	/// Remembers that witness disproves the pair of ids (a, b)
+	void insert(uint64_t a, uint64_t b, uint64_t witness, size_t added);
+
+	/// Appends the pairs witness is the witness of to out, as entries
+	void witnessed(uint64_t witness, vector<Entry>& out);
+
+	/// Every slot of the table, free ones have first == 0
+	vector<Entry>::iterator begin() { return entries_.begin(); }
+	vector<Entry>::iterator end() { return entries_.end(); }
+
+  private:
+	struct Link {
+		uint64_t first; // the pair
+		uint64_t second;
+		size_t next; // index into links_ + 1 of the next pair of the witness, 0 for none
+	};
+	struct Head {
+		uint64_t witness; // 0 for a free slot
+		size_t link; // index into links_ + 1 of the last pair inserted
+	};
+
+	/// Returns the chain of the witness, adding it if needed
+	Head& head(uint64_t witness);
+
+	size_t size_ = 0;
+	vector<Entry> entries_;
+	vector<Entry> spare_; // to rehash into when growing
+
+	/// A pair stays in the chain of a witness it has lost
+	size_t witnesses_ = 0;
+	vector<Head> heads_;
+	vector<Head> spare_heads_;
+	vector<Link> links_;
+};
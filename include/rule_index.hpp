@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using std::vector;
+
+/// Hash index over the rules of a population, from the hash of a rule to the
+/// indices of the classifiers holding it.
+///
+/// The index only knows the hashes. Classifiers whose rules collide share a
+/// hash, so a lookup hands every index with the hash to a predicate that
+/// compares the rules.
+///
+/// Entries live in an open addressing table in a flat vector, which only
+/// allocates when it grows. Like the MatchIndex, the index mirrors the order
+/// of the population it belongs to.
+class RuleIndex {
+  public:
+	/// Number of indexed classifiers
+	size_t size() const { return size_; }
+
+	/// Number of entries currently allocated for the table
+	size_t allocated_entries() const { return slots_.capacity() + spare_.capacity(); }
+
+	/// Forgets all classifiers, keeping the allocated memory
+	void clear();
+
+	/// Makes room for n classifiers
+	void reserve(size_t n);
+
+	/// Adds the classifier at index i with a rule of the given hash
+	void insert(uint64_t hash, size_t i);
+
+	/// Removes the classifier at index i, which has a rule of the given hash
+	void erase(uint64_t hash, size_t i);
+
+	/// Records that the classifier at index from, which has a rule of the
+	/// given hash, has moved to index to
+	void move(uint64_t hash, size_t from, size_t to);
+
+	/// Returns the lowest index with the given hash for which same returns
+	/// true, or SIZE_MAX if there is none
+	template <typename F>
+	size_t find(uint64_t hash, F same) const;
+
+  private:
+	struct Slot {
+		uint64_t hash;
+		size_t index; // SIZE_MAX for a free slot
+	};
+
+	size_t size_ = 0;
+	vector<Slot> slots_;
+	vector<Slot> spare_; // to rehash into when growing
+
+	void rehash(size_t n);
+	size_t slot_of(uint64_t hash, size_t i) const;
+};
+
+template <typename F>
+size_t
+RuleIndex::find(uint64_t hash, F same) const {
+	size_t found = SIZE_MAX;
+	if (size_ == 0)
+		return found;
+	const size_t mask = slots_.size() - 1;
+	for (size_t slot = hash & mask; slots_[slot].index != SIZE_MAX; slot = (slot + 1) & mask)
+		if (slots_[slot].hash == hash && slots_[slot].index < found && same(slots_[slot].index))
+			found = slots_[slot].index;
+	return found;
+}
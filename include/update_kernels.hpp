@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "population.hpp"
+#include "xcs_types.hpp"
+
+using std::vector;
+
+/// The parameters of the classifiers of an action set that updating it
+/// reads or writes, gathered from the population into contiguous columns, so
+/// that the updates run as plain loops the compiler can vectorize. Entry k
+/// belongs to the k-th classifier of the action set.
+///
+/// A view is meant to be kept from one trial to the next, so that gathering
+/// only allocates while the action sets still grow.
+struct ActionSetView {
+	vector<unsigned int> experience;
+	vector<double> prediction;
+	vector<double> prediction_error;
+	vector<double> actionset_size;
+	vector<double> numerosity;
+	vector<double> fitness;
+	vector<double> accuracy; // written by update_action_set
+	vector<char> erroneous; // written by update_action_set
+
+	size_t size() const { return experience.size(); }
+
+	/// Loads the classifiers of action_set from pop
+	void gather(const Population& pop, const ClassifierSet& action_set);
+
+	/// Writes experience, prediction, prediction error, action set size and
+	/// fitness back to the classifiers of action_set in pop
+	void scatter(Population& pop, const ClassifierSet& action_set) const;
+};
+
+/// Returns x^N by repeated squaring, unrolled at compile time
+template <unsigned int N>
+inline double
+int_pow(double x) {
+	return (N % 2 ? x : 1) * int_pow<N / 2>(x * x);
+}
+
+template <>
+inline double
+int_pow<0>(double) {
+	return 1;
+}
+
+/// Whether POWER_PARAMETER is whole and small enough for int_pow
+constexpr bool WHOLE_POWER =
+    POWER_PARAMETER >= 0 && POWER_PARAMETER < 64 && POWER_PARAMETER == (unsigned int) POWER_PARAMETER;
+
+/// Accuracy of a classifier with the given prediction error. A whole
+/// POWER_PARAMETER is raised by int_pow, which takes a few multiplications
+/// per call where pow takes a transcendental evaluation. Any other exponent
+/// goes through pow.
+inline double
+accuracy_of(double prediction_error) {
+	const double x = prediction_error / EPSILON_ZERO;
+	const double accuracy = WHOLE_POWER ? ALPHA / int_pow<WHOLE_POWER ? (unsigned int) POWER_PARAMETER : 0>(x)
+	                                    : ALPHA * std::pow(x, -POWER_PARAMETER);
+	return prediction_error < EPSILON_ZERO ? 1 : accuracy;
+}
+
+/// Returns (1 - BETA)^n, the weight the Widrow-Hoff rule leaves to a value
+/// after n updates. Looked up in a table computed once for every experience
+/// the value does not vanish at.
+double
+beta_decay(unsigned int n);
+
+/// Updates experience, prediction, action set size estimate and prediction
+/// error of every classifier in view for reward, the moving average of
+/// MAM while the experience is below 1 / BETA and the Widrow-Hoff rule
+/// after. Computes the accuracy from the new prediction error on the way.
+///
+/// A classifier is marked erroneous if its prediction error has just risen
+/// above PRED_ERR_TOL at an experience of at least 2 * MIN_EXP.
+///
+/// Returns the sum of accuracy times numerosity over the view
+double
+update_action_set(ActionSetView& view, double reward, double total_numerosity);
+
+/// Computes the accuracy of every classifier in view from its prediction
+/// error and returns the sum of accuracy times numerosity
+double
+update_accuracy(ActionSetView& view);
+
+/// Moves the fitness of every classifier in view towards its share of
+/// accuracy_sum, the sum update_action_set or update_accuracy returned
+void
+update_fitness(ActionSetView& view, double accuracy_sum);
@@ -1,6 +1,38 @@
 #pragma once
 
+#include <cstdint>
+
+/// xoshiro256** pseudo random number generator.
+///
+/// Generators built from the same seed but different streams produce
+/// sequences that do not overlap for 2^128 draws, so several learners can
+/// share a seed and still draw independently. Stream s starts s jumps
+/// ahead, which costs one application of a precomputed jump per set bit of
+/// s, so any 64 bit value can serve as a stream id.
+class Rng {
+  public:
+	explicit Rng(uint64_t seed = 0, uint64_t stream = 0);
+
+	/// Restarts the generator as if it was built from seed and stream
+	void seed(uint64_t seed, uint64_t stream = 0);
+
+	uint64_t next();
+
+	/// Returns a uniformly distributed number in [min, max)
+	double uniform(double min, double max);
+
+	/// Returns a uniformly distributed integer in [min, max]
+	unsigned uniform_uint(unsigned min, unsigned max);
+
+	/// Advances the generator by 2^128 draws
+	void jump();
+
+  private:
+	uint64_t s_[4];
+};
+
 /* Utils.cpp */
+/// Draw from a generator per thread, seeded once from std::random_device
 double
 random_number(const double min, const double max);
 unsigned
@@ -4,10 +4,17 @@
 #include <ostream>
 #include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <optional.hpp>
 
+#include "disproval_cache.hpp"
+#include "overlap_index.hpp"
+#include "population.hpp"
+#include "rejected_pairs.hpp"
+#include "update_kernels.hpp"
+#include "utils.hpp"
 #include "xcs_types.hpp"
 
 using std::set;
@@ -25,10 +32,10 @@ struct clexp { unsigned int cl_exp; unsigned int tot_exp; };
 
 /// Returns number of experienced classifiers of a ClassifierSet
 clexp
-get_exp_classifiers(const ClassifierSet& set);
+get_exp_classifiers(const Population& pop);
 
 /// Returns all possible actions
-set<Action>
+const set<Action>&
 all_actions();
 
 /// Returns a string representation of an action
@@ -39,6 +46,35 @@ action_str(const Action& act);
 bool
 elements_match(const vector<double>& elements, const vector<double>& input);
 
+/// Returns true if the deinterleaved bounds of a condition match on data
+bool
+bounds_match(const double* lower, const double* upper, const double* input, size_t len);
+
+/// Returns true if a ternary condition given by care and value masks matches
+/// on packed input bits
+bool
+bits_match(const uint64_t* care, const uint64_t* value, const uint64_t* input, size_t words);
+
+/// Returns true if the condition of classifier cl matches on the input
+bool
+classifier_matches(const Population& pop, size_t cl, const Input& input);
+
+/// Parses an input string. Strings of only '0' and '1' are binary inputs,
+/// anything else is read as ';' separated real values.
+Input
+transform_input(const std::string& origInput);
+
+/// Loads len real values into input, reusing its memory
+void
+load_input(Input& input, const double* values, size_t len);
+void
+load_input(Input& input, const float* values, size_t len);
+
+/// Loads a binary input of len bits into input, reusing its memory. Bit k
+/// of bits[k / 64] holds position k.
+void
+load_input(Input& input, const uint64_t* bits, size_t len);
+
 std::string
 compose_cond(const vector<double>& elements);
 
@@ -46,51 +82,62 @@ compose_cond(const vector<double>& elements);
 bool
 elements_overlap(const vector<double>& elements1, const vector<double>& elements2);
 
+/// Returns true if two conditions given by their deinterleaved bounds can
+/// match at least one point
+bool
+bounds_overlap(const double* lower1, const double* upper1, const double* lower2, const double* upper2, size_t len);
+
+/// Returns true if the bounds of the subsumer contain the bounds of a condition
+bool
+bounds_subsume(const double* sub_lower, const double* sub_upper, const double* lower, const double* upper, size_t len);
+
 std::ostream&
 operator<<(std::ostream& out, const Classifier& cl);
 
-/// Calculates the total numerosity of a ClassifierSet
+/// Returns the total numerosity of a Population, kept up to date by it
 unsigned int
-set_numerosity(const ClassifierSet &set);
+set_numerosity(const Population& pop);
 
-/// Calculates the total fitness of a ClassifierSet
+/// Returns the total fitness of a Population, kept up to date by it
 double
-set_fitness(const ClassifierSet &set);
+set_fitness(const Population& pop);
 
 /// Inserts a classifier into the given population by either increasing
 /// a matching classifiers numerosity or adding it itself.
-void
-insert_into_population(ClassifierSet& pop, const ClassifierPtr& cl);
+///
+/// Returns the index of the classifier holding the rule
+size_t
+insert_into_population(Population& pop, const Classifier& cl);
 
-/// Generates a match set by matching all classifiers to the Condition sigma
-std::pair<ClassifierSet, bool>
-generate_match_set(ClassifierSet& pop, const ActionSpace& as,
-				   std::string origInput, const size_t& max_pop_size);
+/// Generates a match set by matching all classifiers to the Condition sigma.
+/// The match set is written into match_set, reusing its memory. Returns true
+/// if classifiers had to be deleted to make room for covering.
+bool
+generate_match_set(Population& pop, const ActionSpace& as, const Input& input,
+                   const size_t& max_pop_size, ClassifierSet& match_set, Rng& rng);
 
 /// Returns the number of different actions of a set of classifiers
 unsigned int
-num_different_actions(const ClassifierSet& classifiers);
-unsigned int
-num_different_actions(const ClassifierSet& classifiers);
+num_different_actions(const Population& pop, const ClassifierSet& classifiers);
 
 /// Returns the number of different actions of a set of rules
 unsigned int
 num_different_actions(const RuleSet& rules);
 
-/// Generates a new classifier that covers the situation sigma
-Classifier
-generate_covering_classifier(ClassifierSet& match_set, const ActionSpace& as, const vector<double>& input);
-
-/// Returns all rules from a set of classifiers
-RuleSet
-classifer_set_rules(const ClassifierSet& classifiers);
-RuleSet
-classifer_set_rules(const ClassifierSet& classifiers);
+/// Inserts a new classifier that covers the situation sigma with an action
+/// not in present, the actions of the match set, and returns its index
+size_t
+insert_covering_classifier(Population& pop, const ActionMask& present, const ActionSpace& as,
+                           const Input& input, Rng& rng);
 
 /// Returns all actions that are present in a given RuleSet
 set<Action>
 present_actions(const RuleSet& rules);
 
+/// Returns all actions that are present in a set of classifiers
+ActionMask
+present_actions(const Population& pop, const ClassifierSet& classifiers);
+
 /// Returns the set difference lhs - rhs.
 set<Action>
 actions_diff(const set<Action>& lhs, const set<Action>& rhs);
@@ -99,7 +146,11 @@ actions_diff(const set<Action>& lhs, const set<Action>& rhs);
 ///
 /// Returns nullopt if the set is empty
 optional<Action>
-random_action(const set<Action>& actions);
+random_action(const set<Action>& actions, Rng& rng);
+
+/// Same as above, the actions are taken in ascending order
+optional<Action>
+random_action(const ActionMask& actions, Rng& rng);
 
 /// Deletes classifiers from population, that are low in their fitness.
 /// It also assures an approximately equal number of classifiers
@@ -111,60 +162,188 @@ random_action(const set<Action>& actions);
 /// Returns true if it removed a classifier from the given population, false
 /// if it left the population untouched
 bool
-delete_from_population(ClassifierSet& pop, const vector<double>& input);
+delete_from_population(Population& pop, const Input& input, Rng& rng);
 
 /// Returns a deletion sore, based on fitness, numerosity, ...
 double
-get_del_prop(const Classifier& cl, const double avg_fitness);
+get_del_prop(const Population& pop, size_t i, const double avg_fitness);
 
-/// Returns a prediction array as a map which assigns each action
-/// out of the match_set a fitness value.
-PredictionArray
-generate_prediction_array(const ClassifierSet& match_set);
+/// Writes the prediction array of the match set, which assigns each of its
+/// actions a fitness weighted prediction, into pa, reusing its memory.
+void
+generate_prediction_array(const Population& pop, const ClassifierSet& match_set, PredictionArray& pa);
 
 /// Selects an action either randomly when explore is set, or
-/// an optimal one from the pa.
+/// an optimal one from the pa. Of several optimal ones, it takes the one
+/// that appears last in pa.
 ///
 /// When choosing random actions it prefers actions that are not
 /// present yet in the prediction array.
 int
-select_action(const PredictionArray& pa, ActionMode mode);
+select_action(const PredictionArray& pa, ActionMode mode, Rng& rng);
 
-/// Returns all classifiers out of match_set that are using the
-/// given action act.
-ClassifierSet
-generate_action_set(const ClassifierSet& match_set, const Action act);
+/// Writes all classifiers out of match_set that are using the
+/// given action act into action_set, reusing its memory.
+void
+generate_action_set(const Population& pop, const ClassifierSet& match_set, const Action act,
+                    ClassifierSet& action_set);
 
-/// Updates the fitness of the given action_set.
+/// Updates the fitness of the given action_set, gathering it into view.
 void
-update_fitness(ClassifierSet& action_set);
+update_fitness(Population& pop, const ClassifierSet& action_set, ActionSetView& view);
 
-/// Updates the given action_set.
+/// Updates the given action_set, gathering it into view, which keeps its
+/// memory from one call to the next.
 /// Returns true if population was modified
 bool
-update_set(std::string origInput, const Action act, double reward, ClassifierSet& action_set, ClassifierSet& pop);
+update_set(const Input& input, const Action act, double reward, ClassifierSet& action_set, Population& pop,
+           ActionSetView& view);
 
 /// Returns true if cl_gen is more general than cl_spec
 bool
 is_more_general(const Classifier& cl_gen, const Classifier& cl_spc);
 
-/// Deletes a given classifier from a ClassiferSet.
+/// Deletes the classifier at index i from the population in O(1). The last
+/// classifier takes its index, so deleting several at once has to go from
+/// the highest index down.
 ///
 /// Returns true if deletion was sucessfull
 bool
-delete_classifier(ClassifierSet& clset, ClassifierPtr cl);
+delete_classifier(Population& pop, size_t i);
+
+/// Returns where the classifier at index cl of a population of the given
+/// size ends up once delete_classifier has deleted the sorted victims from
+/// the highest index down, or SIZE_MAX if it is one of them
+size_t
+index_after_deleting(size_t cl, const ClassifierSet& victims, size_t size);
 
+/// Returns true if classifier i can be subsumed by classifier subsumer
 bool
-is_subsumable(ClassifierPtr cl, ClassifierPtr subsumer);
+is_subsumable(const Population& pop, size_t i, size_t subsumer);
 
 /// Returns true if it has modified the population
 bool
-remove_outlier(ClassifierPtr& pop);
+remove_outlier(Population& pop);
+
+/// Sorts the population by action, then descending prediction, then condition
+void
+sort_population(Population& pop);
 
+/// Combines the classifiers of every action of the action space, each
+/// action on one of the given number of threads, 0 meaning one per core.
+/// The result does not depend on the number of threads.
+///
+/// Given one DisprovalCache per action, kept from the previous call on the
+/// same population, only pairs involving classifiers changed since then are
+/// examined in full. The merges are the same as without it.
+///
 /// Returns true if it has modified the population
 bool
-combine_set(const ActionSpace& as, ClassifierSet& pop);
+combine_set(const ActionSpace& as, Population& pop, unsigned int threads = 0,
+            vector<DisprovalCache>* caches = nullptr);
+
+/// Where combining the classifiers of a single action has stopped.
+///
+/// Combining sweeps over the original candidates once, pairing each with the
+/// ones after it. Every merge then queues work for what it has changed: a
+/// row pairing the merged classifier with all candidates, and the pairs
+/// whose witness it has erased. Combining ends when the queues are empty.
+struct CombineCursor {
+	bool started = false;
+	ClassifierSet candidates;
+	size_t sorted = 0; // candidates ordered by prediction, merged ones follow
+	size_t i = 0; // row of the sweep
+	size_t j = 0; // next partner of the row, a position in candidates
+	OverlapIndex overlaps;
+
+	/// Ids of the classifiers whose row is due and the pairs to examine
+	/// again, each with the next one to take
+	vector<uint64_t> rows;
+	size_t next_row = 0;
+	bool in_row = false;
+	size_t window = 0; // end of the sorted candidates in range of the row
+	vector<RejectedPairs::Entry> retry;
+	size_t next_retry = 0;
+
+	/// Id and index of every classifier, sorted by id. Merged classifiers
+	/// get the highest ids yet, erased ones keep SIZE_MAX as index.
+	vector<std::pair<uint64_t, size_t>> ids;
+
+	/// Pairs known to be disproved, the classifiers added by merging, and
+	/// the ids of the classifiers erased or changed by merging, sorted
+	RejectedPairs rejected;
+	ClassifierSet added;
+	vector<uint64_t> gone;
+
+	/// Scratch storage, reused from one candidate to the next
+	Condition star_cond;
+	ClassifierSet examined;
+	ClassifierSet disprovers;
+	ClassifierSet deletions;
+};
+
+/// Storage combine_set reuses from one call to the next
+struct CombiningBuffers {
+	vector<Population> parts; // one per action
+	vector<CombineCursor> cursors;
+};
+
+/// Same as combine_set above, keeping the population of every action and
+/// the scratch storage of combining in buffers, so that passes after the
+/// first one only allocate when the population grows
+bool
+combine_set(const ActionSpace& as, Population& pop, CombiningBuffers& buffers, unsigned int threads = 0,
+            vector<DisprovalCache>* caches = nullptr);
+
+/// Storage reconcile_combined reuses from one call to the next
+struct ReconcileScratch {
+	/// Id and index of every classifier of each population, sorted by id
+	vector<std::pair<uint64_t, size_t>> live;
+	vector<std::pair<uint64_t, size_t>> snapshot;
+	vector<std::pair<uint64_t, size_t>> combined;
+	ClassifierSet stars;
+	vector<long> numerosity;
+	ClassifierSet victims;
+};
+
+/// A combining pass over a copy of a population, carried out by several
+/// calls of combine_set
+struct CombiningPass {
+	bool running = false;
+	Population snapshot; // the population when the pass started
+	Population combined;
+	vector<Population> parts; // one per action
+	vector<CombineCursor> cursors;
+	size_t action = 0; // being combined
+	ReconcileScratch reconcile;
+};
+
+/// Goes on with pass, or starts it over a copy of pop, and stops once
+/// budget candidate pairs have been examined. When the pass is complete, its
+/// result is reconciled with pop, which has gone on learning in the meantime,
+/// and replaces it. Apart from that, the merges are those of combine_set
+/// above.
+///
+/// Returns true if the pass is complete
+bool
+combine_set(const ActionSpace& as, Population& pop, CombiningPass& pass, size_t budget,
+            vector<DisprovalCache>* caches = nullptr);
+
+/// Brings combined, the result of combining a copy of snapshot, up to date
+/// with live, the population the snapshot was taken from and that went on
+/// learning. Classifiers inserted into live since are added and deleted ones
+/// removed. Changes to the numerosity, experience and prediction of
+/// classifiers that combining has merged are replayed onto the classifier
+/// that absorbed them, the other parameters of survivors are taken from live.
+void
+reconcile_combined(const Population& snapshot, const Population& live, Population& combined);
+
+/// Same as reconcile_combined above, keeping its tables in scratch, so that
+/// later calls only allocate when the populations grow
+void
+reconcile_combined(const Population& snapshot, const Population& live, Population& combined,
+                   ReconcileScratch& scratch);
 
-/// Print classifier set to the console
+/// Print population to the console
 void
-print_pop(ClassifierSet pop, bool onlyExp);
+print_pop(const Population& pop, bool onlyExp);
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <bitset>
 #include <cmath>
 #include <cstdint>
 #include <iostream>
@@ -14,10 +15,11 @@
 using std::vector;
 using std::string;
 using std::unordered_map;
-using std::shared_ptr;
 
 using Action = uint8_t;
 using ActionSpace = std::set<Action>;
+/// A set of actions that lives on the stack, bit a standing for action a
+using ActionMask = std::bitset<256>;
 
 enum class ActionMode {
 	Explore,
@@ -37,6 +39,24 @@ struct Rule {
 };
 using RuleSet = vector<Rule>;
 
+/// A problem input, parsed once per trial. Binary inputs are packed into
+/// 64 bit words, bit k holding position k. Real valued inputs are kept as doubles.
+struct Input {
+	bool binary = false;
+	size_t len = 0;
+	vector<double> values;
+	vector<uint64_t> bits;
+};
+
+/// A condition outside of a population, in the layout of the population it
+/// belongs to: deinterleaved bounds or, for binary populations, care and value masks.
+struct Condition {
+	vector<double> lower;
+	vector<double> upper;
+	vector<uint64_t> care;
+	vector<uint64_t> value;
+};
+
 /// The XCS classifier represents knowledge about a problem
 /// using a condition-action-prediction rule.
 ///
@@ -45,7 +65,6 @@ class Classifier {
   public:
 	Rule rule = {.elements = {}, .act = 0};
 
-	string cond = "";
 	/// The prediction 'p' estimates(keeps an average of) the payoff
 	/// exptected if the classifier matches and its action is taken
 	// by the system.
@@ -78,48 +97,18 @@ class Classifier {
 		return rule == rhs.rule && prediction == rhs.prediction && prediction_error == rhs.prediction_error &&
 		       fitness == rhs.fitness && experience == rhs.experience && numerosity == rhs.numerosity;
 	}
-
-	// Compare by action, then condition, then prediction
-	bool operator<(const Classifier& rhs) const {
-		if (rule.act != rhs.rule.act) {
-			return rule.act < rhs.rule.act;
-		}
-		// assert(rule.act == rhs.rule.act);
-
-		auto cond_ord = [](const string& lhs, const string& rhs) {
-			auto cond_to_num = [](const string& cond) {
-				size_t num = 0;
-				const size_t sz = cond.size() - 1;
-				size_t n = 0;
-				for (int i = sz; i >= 0; i--, n++) {
-					switch (cond[i]) {
-					case '0':
-						break;
-					case '1':
-						num += std::pow(2, n);
-						break;
-					case '#':
-						num += std::pow(2, n) + 1; // TODO: Is this right?
-						break;
-					default:
-						break;
-					}
-				}
-				return num;
-			};
-			return cond_to_num(lhs) < cond_to_num(rhs);
-		};
-
-		if (prediction != rhs.prediction) {
-			return prediction > rhs.prediction;
-		}
-
-		return cond_ord(cond, rhs.cond);
-	}
 };
 
-using ClassifierPtr = shared_ptr<Classifier>;
-using ClassifierSet = vector<ClassifierPtr>;
+/// A set of classifiers given by their indices into a Population
+using ClassifierSet = vector<size_t>;
+
+/// The fitness weighted prediction of an action in a match set
+struct ActionPrediction {
+	Action act;
+	double prediction;
+	double fitness; // sum over the classifiers of the action
+};
 
-/// TODO: Think about different Action types like integers
-using PredictionArray = unordered_map<Action, double, std::hash<Action>>;
+/// The predictions of the actions of a match set, in the order the actions
+/// first appear in it
+using PredictionArray = vector<ActionPrediction>;
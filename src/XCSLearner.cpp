@@ -1,37 +1,145 @@
 #include <XCSLearner.hpp>
-#include <algorithm>
+
+#include <cassert>
 
 namespace xcs_rc {
 
-Action XCSLearner::take_action(std::string state, ActionMode mode) {
-	auto ms = generate_match_set(pop, action_space, state, max_pop_size);
-	match_set = ms.first;
-	dirty |= ms.second;
+Action XCSLearner::take_action(const std::string& state, ActionMode mode) {
+	input = transform_input(state);
+	return take_action(mode);
+}
+
+Action XCSLearner::take_action(const double* state, size_t len, ActionMode mode) {
+	load_input(input, state, len);
+	return take_action(mode);
+}
+
+Action XCSLearner::take_action(const float* state, size_t len, ActionMode mode) {
+	load_input(input, state, len);
+	return take_action(mode);
+}
+
+Action XCSLearner::take_action(const uint64_t* state, size_t len, ActionMode mode) {
+	load_input(input, state, len);
+	return take_action(mode);
+}
+
+Action XCSLearner::take_action(ActionMode mode) {
+	dirty |= generate_match_set(pop, action_space, input, max_pop_size, match_set, rng);
 
-	PredictionArray pa = generate_prediction_array(match_set);
+	generate_prediction_array(pop, match_set, prediction_array);
 
-	Action output = select_action(pa, mode);
-	action_set = generate_action_set(match_set, output);
+	Action output = select_action(prediction_array, mode, rng);
+	generate_action_set(pop, match_set, output, action_set);
+	action_set_generation = pop.generation();
 
 	trials++;
 
 	return output;
 }
 
-void XCSLearner::update_with_reward(std::string origInput, const Action act, double reward) {
-	dirty |= update_set(origInput, act, reward, action_set, pop);
-	if ((trials % combining_period == 0) && dirty) {
-		std::sort(pop.begin(), pop.end(), [](const ClassifierPtr& l, const ClassifierPtr& r) { return *l < *r; });
-		dirty |= combine_set(action_space, pop);
+void XCSLearner::update_with_reward(const std::string&, const Action act, double reward) {
+	update_with_reward(act, reward);
+}
+
+void XCSLearner::update_with_reward(const Action act, double reward) {
+	// the population must not change between take_action and update_with_reward
+	assert(action_set_generation == pop.generation());
+	if (adaptive_combining) {
+		size_t fresh = 0;
+		for (size_t cl : action_set)
+			fresh += pop.experience(cl) + 1 == MIN_EXP;
+		combining_trigger.experienced(fresh);
+	}
+	dirty |= update_set(input, act, reward, action_set, pop, action_view);
+	if (combining_pass.running)
+		advance_combining(combining_budget ? combining_budget : SIZE_MAX);
+	if (!combining_due())
+		return;
+	if (background_combining) {
+		// never wait for a pass that is still running
+		if (combiner.joinable() && !combining_done)
+			return;
+		finish_combining();
+		if (dirty)
+			start_combining();
+		dirty = false;
+	} else if (combining_budget > 0) {
+		// a pass still under way is completed first
+		if (dirty && !combining_pass.running) {
+			combining_trigger.started(pop, action_space.size(), trials);
+			advance_combining(combining_budget);
+			dirty = false;
+		}
+	} else if (dirty) {
+		combining_trigger.started(pop, action_space.size(), trials);
+		const size_t before = pop.size();
+		// combine_set sorts the population itself
+		dirty |= combine_set(action_space, pop, combining_buffers, combining_threads, combining_caches());
+		combining_trigger.finished(before, pop.size());
 		// TODO: intentional?
 		dirty = false;
 	}
 }
 
+bool XCSLearner::combining_due() const {
+	if (adaptive_combining)
+		return combining_trigger.due(pop, max_pop_size, trials);
+	return trials % combining_period == 0;
+}
+
+void XCSLearner::start_combining() {
+	assert(!combiner.joinable());
+	snapshot = pop;
+	combined = pop;
+	combining_done = false;
+	combining_trigger.started(pop, action_space.size(), trials);
+	// the worker only reads what it is handed here, the caches come back
+	// when it is joined
+	combiner_disprovals.swap(disprovals);
+	vector<DisprovalCache>* caches = incremental_combining ? &combiner_disprovals : nullptr;
+	const ActionSpace actions = action_space;
+	const unsigned int threads = combining_threads;
+	combiner = std::thread([this, actions, threads, caches] {
+		combine_set(actions, combined, combining_buffers, threads, caches);
+		combining_done = true;
+	});
+}
+
+void XCSLearner::finish_combining() {
+	if (combining_pass.running)
+		advance_combining(SIZE_MAX);
+	if (!combiner.joinable())
+		return;
+	combiner.join();
+	disprovals.swap(combiner_disprovals);
+	const size_t before = pop.size();
+	reconcile_combined(snapshot, pop, combined, reconcile_scratch);
+	std::swap(pop, combined);
+	combining_trigger.finished(before, pop.size());
+}
+
+void XCSLearner::advance_combining(size_t budget) {
+	const size_t before = pop.size();
+	if (combine_set(action_space, pop, combining_pass, budget, combining_caches()))
+		combining_trigger.finished(before, pop.size());
+}
+
+XCSLearner::~XCSLearner() {
+	if (combiner.joinable())
+		combiner.join();
+}
+
 void XCSLearner::reset() {
+	if (combiner.joinable())
+		combiner.join();
+	combining_pass.running = false;
 	this->pop.clear();
 	this->match_set.clear();
 	this->action_set.clear();
+	disprovals.clear();
+	combiner_disprovals.clear();
+	combining_trigger.reset();
 	trials = 0;
 }
 
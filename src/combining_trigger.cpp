@@ -0,0 +1,41 @@
+#include <combining_trigger.hpp>
+
+#include <algorithm>
+
+bool
+CombiningTrigger::due(const Population& pop, size_t max_pop_size, size_t trials) const {
+	const size_t since = trials - last_;
+	if (pairs_per_trial > 0 && since * pairs_per_trial < cost_)
+		return false;
+	if (since >= std::min(std::max(interval_, min_interval), max_interval))
+		return true;
+
+	// the closer the population is to its limit, the fewer it takes
+	const size_t numerosity = pop.total_numerosity();
+	const double room = numerosity < max_pop_size ? double(max_pop_size - numerosity) / max_pop_size : 0;
+	return since >= min_interval && fresh_ >= std::max(1.0, burst * room);
+}
+
+void
+CombiningTrigger::started(const Population& pop, size_t actions, size_t trials) {
+	last_ = trials;
+	fresh_ = 0;
+	const double per_action = double(pop.experienced()) / std::max<size_t>(actions, 1);
+	cost_ = actions * per_action * per_action / 2;
+}
+
+void
+CombiningTrigger::finished(size_t before, size_t after) {
+	const double yield = after < before ? double(before - after) / before : 0;
+	interval_ = std::max(interval_, min_interval);
+	interval_ = yield >= target_yield ? interval_ / 2 : interval_ * 2;
+	interval_ = std::min(std::max(interval_, min_interval), max_interval);
+}
+
+void
+CombiningTrigger::reset() {
+	interval_ = 0;
+	fresh_ = 0;
+	last_ = 0;
+	cost_ = 0;
+}
@@ -0,0 +1,220 @@
+#include <deletion_wheel.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+#include "constants.h"
+
+namespace {
+
+const double infinity = std::numeric_limits<double>::infinity();
+
+size_t
+leaves_for(size_t n) {
+	size_t leaves = 1;
+	while (leaves < n)
+		leaves *= 2;
+	return leaves;
+}
+
+} // namespace
+
+void
+DeletionWheel::reset() {
+	size_ = 0;
+	leaves_ = 0;
+	mean_ = 0;
+	threshold_ = 0;
+	vote_.clear();
+	ratio_.clear();
+	fitness_.clear();
+	numerosity_.clear();
+	ranked_.clear();
+	tree_.clear();
+}
+
+void
+DeletionWheel::reserve(size_t n) {
+	vote_.reserve(n);
+	ratio_.reserve(n);
+	fitness_.reserve(n);
+	numerosity_.reserve(n);
+	ranked_.reserve(n);
+	tree_.reserve(2 * leaves_for(n));
+}
+
+size_t
+DeletionWheel::allocated_entries() const {
+	return vote_.capacity() + ratio_.capacity() + fitness_.capacity() + numerosity_.capacity() + ranked_.capacity() +
+	       tree_.capacity();
+}
+
+void
+DeletionWheel::assign(const double* actionset_size, const unsigned int* numerosity, const double* fitness,
+                      const unsigned int* experience, size_t n) {
+	reset();
+	size_ = n;
+	vote_.resize(n);
+	ratio_.resize(n);
+	fitness_.resize(n);
+	numerosity_.resize(n);
+	ranked_.resize(n);
+	double total_fitness = 0;
+	double total_numerosity = 0;
+	for (size_t i = 0; i < n; i++) {
+		vote_[i] = actionset_size[i] * numerosity[i];
+		ratio_[i] = numerosity[i] ? fitness[i] / numerosity[i] : 0;
+		fitness_[i] = fitness[i];
+		numerosity_[i] = numerosity[i];
+		ranked_[i] = numerosity[i] > 0 && experience[i] >= THETA_DEL;
+		total_fitness += fitness[i];
+		total_numerosity += numerosity[i];
+	}
+	if (total_numerosity > 0)
+		threshold_ = DELTA_DELETION * (total_fitness / total_numerosity);
+	leaves_ = leaves_for(n);
+	build_tree();
+}
+
+void
+DeletionWheel::push_back(double actionset_size, unsigned int numerosity, double fitness, unsigned int experience) {
+	// grow all members together, so that a later reserve() of the same size finds them large enough
+	if (size_ == vote_.capacity())
+		reserve(std::max<size_t>(1, 2 * size_));
+	vote_.push_back(0);
+	ratio_.push_back(0);
+	fitness_.push_back(0);
+	numerosity_.push_back(0);
+	ranked_.push_back(false);
+	size_++;
+	set(size_ - 1, actionset_size, numerosity, fitness, experience);
+	if (size_ > leaves_) {
+		leaves_ = leaves_for(size_);
+		build_tree();
+	} else {
+		fix_path(size_ - 1);
+	}
+}
+
+void
+DeletionWheel::update(size_t i, double actionset_size, unsigned int numerosity, double fitness,
+                      unsigned int experience) {
+	assert(i < size_);
+	set(i, actionset_size, numerosity, fitness, experience);
+	fix_path(i);
+}
+
+void
+DeletionWheel::swap_erase(size_t i) {
+	assert(i < size_);
+	const size_t last = size_ - 1;
+	if (i != last) {
+		vote_[i] = vote_[last];
+		ratio_[i] = ratio_[last];
+		fitness_[i] = fitness_[last];
+		numerosity_[i] = numerosity_[last];
+		ranked_[i] = ranked_[last];
+		fix_path(i);
+	}
+	vote_.pop_back();
+	ratio_.pop_back();
+	fitness_.pop_back();
+	numerosity_.pop_back();
+	ranked_.pop_back();
+	size_--;
+	fix_path(last);
+}
+
+double
+DeletionWheel::vote_sum() {
+	if (size_ == 0)
+		return 0;
+	mean_ = tree_[1].f / tree_[1].n;
+	const double threshold = DELTA_DELETION * mean_;
+	if (threshold != threshold_) {
+		// only the classifiers between the old and the new threshold change sides
+		threshold_ = threshold;
+		reclassify(1);
+	}
+	return mean_ * tree_[1].a + tree_[1].b;
+}
+
+size_t
+DeletionWheel::find(double choice) const {
+	if (size_ == 0)
+		return 0;
+	size_t node = 1;
+	while (node < leaves_) {
+		const Node& left = tree_[2 * node];
+		const double weight = mean_ * left.a + left.b;
+		if (choice < weight) {
+			node = 2 * node;
+		} else {
+			choice -= weight;
+			node = 2 * node + 1;
+		}
+	}
+	const size_t i = node - leaves_;
+	// rounding can carry the descent past the last classifier
+	return i < size_ ? i : size_;
+}
+
+void
+DeletionWheel::set(size_t i, double actionset_size, unsigned int numerosity, double fitness,
+                   unsigned int experience) {
+	vote_[i] = actionset_size * numerosity;
+	ratio_[i] = numerosity ? fitness / numerosity : 0;
+	fitness_[i] = fitness;
+	numerosity_[i] = numerosity;
+	ranked_[i] = numerosity > 0 && experience >= THETA_DEL;
+}
+
+DeletionWheel::Node
+DeletionWheel::leaf(size_t i) const {
+	if (i >= size_ || numerosity_[i] == 0)
+		return Node{0, 0, i < size_ ? fitness_[i] : 0, 0, infinity, -infinity};
+	if (!ranked_[i])
+		return Node{vote_[i] / ratio_[i], 0, fitness_[i], numerosity_[i], infinity, -infinity};
+	if (ratio_[i] >= threshold_)
+		return Node{vote_[i] / ratio_[i], 0, fitness_[i], numerosity_[i], ratio_[i], -infinity};
+	return Node{0, vote_[i], fitness_[i], numerosity_[i], infinity, ratio_[i]};
+}
+
+DeletionWheel::Node
+DeletionWheel::join(const Node& l, const Node& r) {
+	return Node{l.a + r.a, l.b + r.b, l.f + r.f, l.n + r.n, std::min(l.lowest_a, r.lowest_a),
+	            std::max(l.highest_b, r.highest_b)};
+}
+
+void
+DeletionWheel::fix_path(size_t i) {
+	size_t node = leaves_ + i;
+	tree_[node] = leaf(i);
+	for (node /= 2; node > 0; node /= 2)
+		tree_[node] = join(tree_[2 * node], tree_[2 * node + 1]);
+}
+
+void
+DeletionWheel::build_tree() {
+	tree_.resize(2 * leaves_);
+	for (size_t k = 0; k < leaves_; k++)
+		tree_[leaves_ + k] = leaf(k);
+	for (size_t node = leaves_; node-- > 1;)
+		tree_[node] = join(tree_[2 * node], tree_[2 * node + 1]);
+}
+
+void
+DeletionWheel::reclassify(size_t node) {
+	// a node only holds a classifier on the wrong side if its lowest on a or
+	// its highest on b is
+	if (tree_[node].lowest_a >= threshold_ && tree_[node].highest_b < threshold_)
+		return;
+	if (node >= leaves_) {
+		tree_[node] = leaf(node - leaves_);
+		return;
+	}
+	reclassify(2 * node);
+	reclassify(2 * node + 1);
+	tree_[node] = join(tree_[2 * node], tree_[2 * node + 1]);
+}
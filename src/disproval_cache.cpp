@@ -0,0 +1,192 @@
+#include <disproval_cache.hpp>
+
+#include <algorithm>
+
+#include "id_hash.hpp"
+
+void
+DisprovalCache::clear() {
+	size_ = 0;
+	pairs_.clear();
+	disprovers_.clear();
+	ids_ = 0;
+	index_.clear();
+	changes_.clear();
+}
+
+void
+DisprovalCache::begin(const Population& pop) {
+	for (Entry& entry : pairs_)
+		entry.used = false;
+	changes_.clear();
+	for (size_t cl = 0; cl < pop.size(); cl++)
+		changes_.push_back(std::make_pair(pop.stamp(cl), pop.id(cl)));
+	std::sort(changes_.begin(), changes_.end());
+	index_.assign(std::max(index_.size(), table_size(pop.size())), Slot{0, 0});
+	ids_ = 0;
+	for (size_t cl = 0; cl < pop.size(); cl++)
+		set_index(pop.id(cl), cl);
+}
+
+void
+DisprovalCache::erase(uint64_t id) {
+	const size_t mask = index_.size() - 1;
+	size_t hole = hash_id(id) & mask;
+	for (; index_[hole].id != id; hole = (hole + 1) & mask)
+		if (index_[hole].id == 0)
+			return;
+	// shift back the ids probed past the hole
+	for (size_t slot = (hole + 1) & mask; index_[slot].id != 0; slot = (slot + 1) & mask) {
+		const size_t home = hash_id(index_[slot].id) & mask;
+		if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+			index_[hole] = index_[slot];
+			hole = slot;
+		}
+	}
+	index_[hole] = Slot{0, 0};
+	ids_--;
+}
+
+void
+DisprovalCache::place(const Population& pop, size_t cl) {
+	// inserted or changed classifiers carry the newest stamps
+	if (changes_.empty() || pop.stamp(cl) > changes_.back().first)
+		changes_.push_back(std::make_pair(pop.stamp(cl), pop.id(cl)));
+	if (2 * (ids_ + 1) <= index_.size()) {
+		set_index(pop.id(cl), cl);
+		return;
+	}
+	// grow, indexing the whole population anew
+	index_.assign(table_size(pop.size()), Slot{0, 0});
+	ids_ = 0;
+	for (size_t k = 0; k < pop.size(); k++)
+		set_index(pop.id(k), k);
+}
+
+bool
+DisprovalCache::lookup(const Population& pop, size_t i, size_t j, ClassifierSet& known, ClassifierSet& changed) {
+	Entry* entry = find(pop, i, j);
+	if (!entry)
+		return false;
+	entry->used = true;
+	if (pop.stamp(i) > entry->clock || pop.stamp(j) > entry->clock)
+		return false;
+
+	for (size_t d = entry->begin; d < entry->begin + entry->count; d++) {
+		const size_t cl = index_of(pop, disprovers_[d]);
+		if (cl < pop.size() && pop.stamp(cl) <= entry->clock)
+			known.push_back(cl);
+	}
+	auto first = std::upper_bound(changes_.begin(), changes_.end(),
+	                              std::make_pair(entry->clock, UINT64_MAX));
+	for (; first != changes_.end(); first++) {
+		const size_t cl = index_of(pop, first->second);
+		// a classifier changed twice is found through its last change
+		if (cl < pop.size() && pop.stamp(cl) == first->first && cl != i && cl != j)
+			changed.push_back(cl);
+	}
+	return true;
+}
+
+void
+DisprovalCache::store(const Population& pop, size_t i, size_t j, const ClassifierSet& disprovers) {
+	Entry& entry = insert(std::min(pop.id(i), pop.id(j)), std::max(pop.id(i), pop.id(j)));
+	entry.clock = pop.clock();
+	entry.used = true;
+	// overwrite in place if there is room, otherwise end() drops the old ones
+	if (disprovers.size() > entry.count)
+		entry.begin = disprovers_.size();
+	entry.count = disprovers.size();
+	if (entry.begin == disprovers_.size())
+		disprovers_.resize(entry.begin + entry.count);
+	for (size_t d = 0; d < disprovers.size(); d++)
+		disprovers_[entry.begin + d] = pop.id(disprovers[d]);
+}
+
+void
+DisprovalCache::end() {
+	// move the pairs looked at into the spare storage and swap
+	kept_pairs_.assign(pairs_.size(), Entry{0, 0, 0, 0, 0, false});
+	kept_disprovers_.clear();
+	const size_t mask = kept_pairs_.size() - 1;
+	size_ = 0;
+	for (const Entry& entry : pairs_) {
+		if (entry.first == 0 || !entry.used)
+			continue;
+		size_t slot = hash_pair(entry.first, entry.second) & mask;
+		while (kept_pairs_[slot].first != 0)
+			slot = (slot + 1) & mask;
+		Entry& kept = kept_pairs_[slot];
+		kept = entry;
+		kept.begin = kept_disprovers_.size();
+		kept_disprovers_.insert(kept_disprovers_.end(), disprovers_.begin() + entry.begin,
+		                        disprovers_.begin() + entry.begin + entry.count);
+		size_++;
+	}
+	pairs_.swap(kept_pairs_);
+	disprovers_.swap(kept_disprovers_);
+	changes_.clear();
+}
+
+DisprovalCache::Entry*
+DisprovalCache::find(const Population& pop, size_t i, size_t j) {
+	if (pairs_.empty())
+		return nullptr;
+	const uint64_t first = std::min(pop.id(i), pop.id(j));
+	const uint64_t second = std::max(pop.id(i), pop.id(j));
+	const size_t mask = pairs_.size() - 1;
+	for (size_t slot = hash_pair(first, second) & mask; pairs_[slot].first != 0; slot = (slot + 1) & mask)
+		if (pairs_[slot].first == first && pairs_[slot].second == second)
+			return &pairs_[slot];
+	return nullptr;
+}
+
+DisprovalCache::Entry&
+DisprovalCache::insert(uint64_t first, uint64_t second) {
+	if (2 * (size_ + 1) > pairs_.size()) {
+		// grow, rehashing the pairs in place of the spare storage
+		kept_pairs_.assign(table_size(size_ + 1), Entry{0, 0, 0, 0, 0, false});
+		const size_t mask = kept_pairs_.size() - 1;
+		for (const Entry& entry : pairs_) {
+			if (entry.first == 0)
+				continue;
+			size_t slot = hash_pair(entry.first, entry.second) & mask;
+			while (kept_pairs_[slot].first != 0)
+				slot = (slot + 1) & mask;
+			kept_pairs_[slot] = entry;
+		}
+		pairs_.swap(kept_pairs_);
+	}
+	const size_t mask = pairs_.size() - 1;
+	size_t slot = hash_pair(first, second) & mask;
+	for (; pairs_[slot].first != 0; slot = (slot + 1) & mask)
+		if (pairs_[slot].first == first && pairs_[slot].second == second)
+			return pairs_[slot];
+	size_++;
+	pairs_[slot] = Entry{first, second, 0, disprovers_.size(), 0, false};
+	return pairs_[slot];
+}
+
+size_t
+DisprovalCache::index_of(const Population& pop, uint64_t id) const {
+	if (index_.empty())
+		return pop.size();
+	const size_t mask = index_.size() - 1;
+	for (size_t slot = hash_id(id) & mask; index_[slot].id != 0; slot = (slot + 1) & mask)
+		if (index_[slot].id == id)
+			return index_[slot].index;
+	return pop.size();
+}
+
+void
+DisprovalCache::set_index(uint64_t id, size_t cl) {
+	const size_t mask = index_.size() - 1;
+	size_t slot = hash_id(id) & mask;
+	for (; index_[slot].id != 0; slot = (slot + 1) & mask)
+		if (index_[slot].id == id) {
+			index_[slot].index = cl;
+			return;
+		}
+	index_[slot] = Slot{id, cl};
+	ids_++;
+}
@@ -0,0 +1,89 @@
+#include <match_index.hpp>
+
+#include <algorithm>
+#include <cassert>
+
+void
+MatchIndex::reset(size_t len) {
+	len_ = len;
+	size_ = 0;
+	words_ = 0;
+	bits_.clear();
+}
+
+void
+MatchIndex::reserve(size_t n) {
+	const size_t words = (n + 63) / 64;
+	if (words > words_)
+		grow(words);
+}
+
+void
+MatchIndex::grow(size_t words) {
+	assert(words > words_);
+	bits_.resize(2 * len_ * words);
+	// move the bitsets apart in place, starting with the last one
+	for (size_t b = 2 * len_; b-- > 0;) {
+		for (size_t w = words_; w-- > 0;)
+			bits_[b * words + w] = bits_[b * words_ + w];
+		std::fill(bits_.begin() + b * words + words_, bits_.begin() + (b + 1) * words, 0);
+	}
+	words_ = words;
+}
+
+void
+MatchIndex::push_back(const uint64_t* care, const uint64_t* value) {
+	if (size_ == capacity())
+		grow(words_ ? 2 * words_ : 1);
+
+	const size_t word = size_ / 64;
+	const uint64_t bit = (uint64_t) 1 << (size_ % 64);
+	for (size_t k = 0; k < len_; k++) {
+		const bool cares = (care[k / 64] >> (k % 64)) & 1;
+		const unsigned v = (value[k / 64] >> (k % 64)) & 1;
+		if (!cares || v == 0)
+			bitset(k, 0)[word] |= bit;
+		if (!cares || v == 1)
+			bitset(k, 1)[word] |= bit;
+	}
+	size_++;
+}
+
+void
+MatchIndex::swap_erase(size_t i) {
+	assert(i < size_);
+	const size_t last = size_ - 1;
+	const uint64_t bit = (uint64_t) 1 << (i % 64);
+	const uint64_t last_bit = (uint64_t) 1 << (last % 64);
+	for (size_t b = 0; b < 2 * len_; b++) {
+		uint64_t* words = bits_.data() + b * words_;
+		if (words[last / 64] & last_bit)
+			words[i / 64] |= bit;
+		else
+			words[i / 64] &= ~bit;
+		words[last / 64] &= ~last_bit;
+	}
+	size_--;
+}
+
+void
+MatchIndex::match(const uint64_t* input, ClassifierSet& out) const {
+	const size_t used = (size_ + 63) / 64;
+	if (used == 0)
+		return;
+
+	scratch_.assign(bitset(0, input[0] & 1), bitset(0, input[0] & 1) + used);
+	for (size_t k = 1; k < len_; k++) {
+		const uint64_t* accepts = bitset(k, (input[k / 64] >> (k % 64)) & 1);
+		for (size_t w = 0; w < used; w++)
+			scratch_[w] &= accepts[w];
+	}
+
+	for (size_t w = 0; w < used; w++) {
+		uint64_t matches = scratch_[w];
+		while (matches) {
+			out.push_back(64 * w + __builtin_ctzll(matches));
+			matches &= matches - 1;
+		}
+	}
+}
@@ -0,0 +1,153 @@
+#include <match_kernels.hpp>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define XCS_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+void
+match_bounds_scalar(const double* lower, const double* upper, size_t n, size_t len, const double* input,
+                    ClassifierSet& out) {
+	for (size_t c = 0; c < n; c++) {
+		const double* lo = lower + c * len;
+		const double* up = upper + c * len;
+		bool match = true;
+		for (size_t k = 0; k < len; k++) {
+			if (lo[k] > input[k] || up[k] < input[k]) {
+				match = false;
+				break;
+			}
+		}
+		if (match)
+			out.push_back(c);
+	}
+}
+
+#ifdef XCS_X86_KERNELS
+
+__attribute__((target("avx2"))) void
+match_bounds_avx2(const double* lower, const double* upper, size_t n, size_t len, const double* input,
+                  ClassifierSet& out) {
+	const size_t tail = len % 4;
+	const __m256i tail_mask = _mm256_setr_epi64x(tail > 0 ? -1 : 0, tail > 1 ? -1 : 0, tail > 2 ? -1 : 0, 0);
+
+	for (size_t c = 0; c < n; c++) {
+		const double* lo = lower + c * len;
+		const double* up = upper + c * len;
+		bool match = true;
+		size_t k = 0;
+		for (; k + 4 <= len; k += 4) {
+			const __m256d in = _mm256_loadu_pd(input + k);
+			const __m256d below = _mm256_cmp_pd(_mm256_loadu_pd(lo + k), in, _CMP_GT_OQ);
+			const __m256d above = _mm256_cmp_pd(_mm256_loadu_pd(up + k), in, _CMP_LT_OQ);
+			if (_mm256_movemask_pd(_mm256_or_pd(below, above))) {
+				match = false;
+				break;
+			}
+		}
+		if (match && tail) {
+			// masked lanes load as zero on all three operands and never mismatch
+			const __m256d in = _mm256_maskload_pd(input + k, tail_mask);
+			const __m256d below = _mm256_cmp_pd(_mm256_maskload_pd(lo + k, tail_mask), in, _CMP_GT_OQ);
+			const __m256d above = _mm256_cmp_pd(_mm256_maskload_pd(up + k, tail_mask), in, _CMP_LT_OQ);
+			match = !_mm256_movemask_pd(_mm256_or_pd(below, above));
+		}
+		if (match)
+			out.push_back(c);
+	}
+}
+
+__attribute__((target("avx512f"))) void
+match_bounds_avx512(const double* lower, const double* upper, size_t n, size_t len, const double* input,
+                    ClassifierSet& out) {
+	const __mmask8 tail_mask = (__mmask8) ((1u << (len % 8)) - 1);
+
+	for (size_t c = 0; c < n; c++) {
+		const double* lo = lower + c * len;
+		const double* up = upper + c * len;
+		bool match = true;
+		size_t k = 0;
+		for (; k + 8 <= len; k += 8) {
+			const __m512d in = _mm512_loadu_pd(input + k);
+			const __mmask8 below = _mm512_cmp_pd_mask(_mm512_loadu_pd(lo + k), in, _CMP_GT_OQ);
+			const __mmask8 above = _mm512_cmp_pd_mask(_mm512_loadu_pd(up + k), in, _CMP_LT_OQ);
+			if (below | above) {
+				match = false;
+				break;
+			}
+		}
+		if (match && tail_mask) {
+			// masked lanes load as zero on all three operands and never mismatch
+			const __m512d in = _mm512_maskz_loadu_pd(tail_mask, input + k);
+			const __mmask8 below = _mm512_cmp_pd_mask(_mm512_maskz_loadu_pd(tail_mask, lo + k), in, _CMP_GT_OQ);
+			const __mmask8 above = _mm512_cmp_pd_mask(_mm512_maskz_loadu_pd(tail_mask, up + k), in, _CMP_LT_OQ);
+			match = !(below | above);
+		}
+		if (match)
+			out.push_back(c);
+	}
+}
+
+bool
+match_path_supported(MatchPath path) {
+	switch (path) {
+	case MatchPath::AVX2:
+		return __builtin_cpu_supports("avx2");
+	case MatchPath::AVX512:
+		return __builtin_cpu_supports("avx512f");
+	default:
+		return true;
+	}
+}
+
+#else
+
+void
+match_bounds_avx2(const double* lower, const double* upper, size_t n, size_t len, const double* input,
+                  ClassifierSet& out) {
+	match_bounds_scalar(lower, upper, n, len, input, out);
+}
+
+void
+match_bounds_avx512(const double* lower, const double* upper, size_t n, size_t len, const double* input,
+                    ClassifierSet& out) {
+	match_bounds_scalar(lower, upper, n, len, input, out);
+}
+
+bool
+match_path_supported(MatchPath path) {
+	return path == MatchPath::Scalar;
+}
+
+#endif
+
+MatchPath
+best_match_path() {
+	// Kernels.bench, a new input per scan: the vector paths take a third to
+	// a quarter of the time of the scalar one. AVX-512 leads where
+	// classifiers are wide and survive many dimensions, elsewhere it is
+	// about level with AVX2.
+	if (match_path_supported(MatchPath::AVX512))
+		return MatchPath::AVX512;
+	if (match_path_supported(MatchPath::AVX2))
+		return MatchPath::AVX2;
+	return MatchPath::Scalar;
+}
+
+BoundsMatchKernel
+match_kernel(MatchPath path) {
+	switch (path) {
+	case MatchPath::AVX2:
+		return match_bounds_avx2;
+	case MatchPath::AVX512:
+		return match_bounds_avx512;
+	default:
+		return match_bounds_scalar;
+	}
+}
+
+void
+match_bounds(const double* lower, const double* upper, size_t n, size_t len, const double* input, ClassifierSet& out) {
+	static const BoundsMatchKernel kernel = match_kernel(best_match_path());
+	kernel(lower, upper, n, len, input, out);
+}
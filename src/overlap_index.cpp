@@ -0,0 +1,187 @@
+#include <overlap_index.hpp>
+
+#include <algorithm>
+#include <cassert>
+
+#include <xcs.hpp>
+
+namespace {
+
+/// Number of entries below which a node is not split any further
+const size_t LEAF_SIZE = 8;
+
+/// Number of queries answered by scanning after the tree did not pay off
+const size_t SCANS_BETWEEN_PROBES = 63;
+
+} // namespace
+
+void
+OverlapIndex::assign(const Population& pop, const ClassifierSet& classifiers) {
+	assert(!pop.binary());
+	len_ = pop.cond_len();
+	live_ = 0;
+	lower_.clear();
+	upper_.clear();
+	cl_.clear();
+	alive_.clear();
+	for (size_t cl : classifiers)
+		push_entry(pop.lower(cl), pop.upper(cl), cl);
+	rebuild();
+}
+
+void
+OverlapIndex::insert(const Population& pop, size_t cl) {
+	assert(!pop.binary() && pop.cond_len() == len_);
+	push_entry(pop.lower(cl), pop.upper(cl), cl);
+	if (cl_.size() - built_ > LEAF_SIZE + built_ / 4)
+		rebuild();
+}
+
+void
+OverlapIndex::swap_erase(const ClassifierSet& victims, size_t size) {
+	for (size_t e = 0; e < cl_.size(); e++) {
+		if (!alive_[e])
+			continue;
+		cl_[e] = index_after_deleting(cl_[e], victims, size);
+		if (cl_[e] == SIZE_MAX) {
+			alive_[e] = false;
+			live_--;
+		}
+	}
+	if (cl_.size() > 2 * live_ + LEAF_SIZE)
+		rebuild();
+}
+
+void
+OverlapIndex::query(const double* lower, const double* upper, ClassifierSet& out) const {
+	if (nodes_.empty() || scans_left_ > 0) {
+		if (scans_left_ > 0)
+			scans_left_--;
+		for (size_t e = 0; e < cl_.size(); e++)
+			if (alive_[e] && bounds_overlap(this->lower(e), this->upper(e), lower, upper, len_))
+				out.push_back(cl_[e]);
+		return;
+	}
+
+	size_t checks = 0; // boxes and conditions compared with the query
+	stack_.clear();
+	stack_.push_back(0);
+	while (!stack_.empty()) {
+		const Node& node = nodes_[stack_.back()];
+		const size_t n = stack_.back();
+		stack_.pop_back();
+		const double* box_lower = node_lower_.data() + n * len_;
+		const double* box_upper = node_upper_.data() + n * len_;
+		checks++;
+		if (!bounds_overlap(box_lower, box_upper, lower, upper, len_))
+			continue;
+		// every condition inside a box the query contains overlaps the query
+		if (bounds_subsume(lower, upper, box_lower, box_upper, len_)) {
+			for (size_t k = node.begin; k < node.end; k++)
+				if (alive_[order_[k]])
+					out.push_back(cl_[order_[k]]);
+			continue;
+		}
+		if (node.left) {
+			stack_.push_back(node.right);
+			stack_.push_back(node.left);
+			continue;
+		}
+		checks += node.end - node.begin;
+		for (size_t k = node.begin; k < node.end; k++) {
+			const size_t e = order_[k];
+			if (alive_[e] && bounds_overlap(this->lower(e), this->upper(e), lower, upper, len_))
+				out.push_back(cl_[e]);
+		}
+	}
+	for (size_t e = built_; e < cl_.size(); e++)
+		if (alive_[e] && bounds_overlap(this->lower(e), this->upper(e), lower, upper, len_))
+			out.push_back(cl_[e]);
+
+	// a tree walk costs more per comparison than a scan, so it has to skip
+	// at least half of the entries to pay off
+	if (2 * checks > built_)
+		scans_left_ = SCANS_BETWEEN_PROBES;
+}
+
+void
+OverlapIndex::push_entry(const double* lower, const double* upper, size_t cl) {
+	lower_.insert(lower_.end(), lower, lower + len_);
+	upper_.insert(upper_.end(), upper, upper + len_);
+	cl_.push_back(cl);
+	alive_.push_back(true);
+	live_++;
+}
+
+void
+OverlapIndex::rebuild() {
+	// drop dead entries
+	size_t live = 0;
+	for (size_t e = 0; e < cl_.size(); e++) {
+		if (!alive_[e])
+			continue;
+		std::copy(lower(e), lower(e) + len_, lower_.begin() + live * len_);
+		std::copy(upper(e), upper(e) + len_, upper_.begin() + live * len_);
+		cl_[live] = cl_[e];
+		live++;
+	}
+	lower_.resize(live * len_);
+	upper_.resize(live * len_);
+	cl_.resize(live);
+	alive_.assign(live, true);
+	assert(live == live_);
+
+	order_.resize(live);
+	for (size_t e = 0; e < live; e++)
+		order_[e] = e;
+	nodes_.clear();
+	node_lower_.clear();
+	node_upper_.clear();
+	if (live > 0)
+		build(0, live);
+	built_ = live;
+	scans_left_ = 0;
+}
+
+size_t
+OverlapIndex::build(size_t begin, size_t end) {
+	const size_t n = nodes_.size();
+	nodes_.push_back(Node{begin, end, 0, 0});
+	node_lower_.insert(node_lower_.end(), lower(order_[begin]), lower(order_[begin]) + len_);
+	node_upper_.insert(node_upper_.end(), upper(order_[begin]), upper(order_[begin]) + len_);
+	double* box_lower = node_lower_.data() + n * len_;
+	double* box_upper = node_upper_.data() + n * len_;
+	for (size_t k = begin + 1; k < end; k++)
+		for (size_t d = 0; d < len_; d++) {
+			box_lower[d] = std::min(box_lower[d], lower(order_[k])[d]);
+			box_upper[d] = std::max(box_upper[d], upper(order_[k])[d]);
+		}
+	if (end - begin <= LEAF_SIZE)
+		return n;
+
+	// split at the median center along the dimension the centers spread most
+	size_t axis = 0;
+	double widest = -1;
+	for (size_t d = 0; d < len_; d++) {
+		double lo = lower(order_[begin])[d] + upper(order_[begin])[d];
+		double hi = lo;
+		for (size_t k = begin + 1; k < end; k++) {
+			const double center = lower(order_[k])[d] + upper(order_[k])[d];
+			lo = std::min(lo, center);
+			hi = std::max(hi, center);
+		}
+		if (hi - lo > widest) {
+			widest = hi - lo;
+			axis = d;
+		}
+	}
+	const size_t mid = begin + (end - begin) / 2;
+	std::nth_element(order_.begin() + begin, order_.begin() + mid, order_.begin() + end, [&](size_t l, size_t r) {
+		return lower(l)[axis] + upper(l)[axis] < lower(r)[axis] + upper(r)[axis];
+	});
+	const size_t left = build(begin, mid);
+	const size_t right = build(mid, end);
+	nodes_[n].left = left;
+	nodes_[n].right = right;
+	return n;
+}
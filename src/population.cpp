@@ -0,0 +1,673 @@
+#include <population.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <functional>
+
+#include "constants.h"
+#include "id_hash.hpp"
+
+namespace {
+
+/// Reorders column like Population::permute(), gathering into spare, which
+/// only grows, and copying back so that the column keeps its storage
+template <typename T>
+void
+permute_column(vector<T>& column, const vector<size_t>& order, vector<char>& spare) {
+	const size_t bytes = column.size() * sizeof(T);
+	if (spare.size() < bytes)
+		spare.resize(bytes);
+	for (size_t k = 0; k < order.size(); k++)
+		std::memcpy(spare.data() + k * sizeof(T), &column[order[k]], sizeof(T));
+	std::memcpy(column.data(), spare.data(), bytes);
+}
+
+/// Reorders the rows of len entries of column likewise
+template <typename T>
+void
+permute_rows(vector<T>& column, const vector<size_t>& order, size_t len, vector<char>& spare) {
+	const size_t row = len * sizeof(T);
+	const size_t bytes = column.size() * sizeof(T);
+	if (spare.size() < bytes)
+		spare.resize(bytes);
+	for (size_t k = 0; k < order.size(); k++)
+		std::memcpy(spare.data() + k * row, column.data() + order[k] * len, row);
+	std::memcpy(column.data(), spare.data(), bytes);
+}
+
+/// Moves the entries at the indices in kept to the front, in order
+template <typename T>
+void
+compact_column(vector<T>& column, const vector<size_t>& kept) {
+	for (size_t k = 0; k < kept.size(); k++)
+		column[k] = column[kept[k]];
+	column.resize(kept.size());
+}
+
+template <typename T>
+void
+compact_rows(vector<T>& column, const vector<size_t>& kept, size_t len) {
+	for (size_t k = 0; k < kept.size(); k++)
+		std::copy(column.begin() + kept[k] * len, column.begin() + (kept[k] + 1) * len, column.begin() + k * len);
+	column.resize(kept.size() * len);
+}
+
+template <typename T>
+void
+move_last(vector<T>& column, size_t i) {
+	column[i] = column.back();
+	column.pop_back();
+}
+
+template <typename T>
+void
+move_last_row(vector<T>& column, size_t i, size_t len) {
+	std::copy(column.end() - len, column.end(), column.begin() + i * len);
+	column.resize(column.size() - len);
+}
+
+/// Adds a word of a rule to its hash
+uint64_t
+mix(uint64_t hash, uint64_t word) {
+	return hash_id(hash ^ word);
+}
+
+/// Returns the bits of a bound, with -0.0 taken as 0.0 since both compare equal
+uint64_t
+bound_bits(double x) {
+	x += 0.0;
+	uint64_t bits;
+	std::memcpy(&bits, &x, sizeof bits);
+	return bits;
+}
+
+/// Returns bound x clamped to [0, 1] and quantised to 8 bits
+uint64_t
+quantise_bound(double x) {
+	return (uint64_t) (std::min(std::max(x, 0.0), 1.0) * 255 + 0.5);
+}
+
+uint64_t
+next_id() {
+	static std::atomic<uint64_t> last(0);
+	return ++last;
+}
+
+} // namespace
+
+void
+Population::clear() {
+	len_ = 0;
+	words_ = 0;
+	binary_ = false;
+	lower_.clear();
+	upper_.clear();
+	care_.clear();
+	value_.clear();
+	act_.clear();
+	prediction_.clear();
+	prediction_error_.clear();
+	fitness_.clear();
+	experience_.clear();
+	actionset_size_.clear();
+	numerosity_.clear();
+	disproving_.clear();
+	disproves_.clear();
+	id_.clear();
+	stamp_.clear();
+	cond_key_.clear();
+	rule_hash_.clear();
+	index_.reset(0);
+	rules_.clear();
+	wheel_.reset();
+	total_numerosity_ = 0;
+	experienced_ = 0;
+	total_experience_ = 0;
+	generation_++;
+}
+
+void
+Population::set_binary(bool binary) {
+	assert(empty());
+	binary_ = binary;
+}
+
+void
+Population::set_match_index(bool enabled) {
+	indexed_ = enabled;
+	rebuild_index();
+}
+
+void
+Population::rebuild_index() {
+	index_.reset(len_);
+	if (!match_index())
+		return;
+	index_.reserve(act_.capacity());
+	for (size_t i = 0; i < size(); i++)
+		index_.push_back(care(i), value(i));
+}
+
+void
+Population::rebuild_rules() {
+	rules_.clear();
+	for (size_t i = 0; i < size(); i++)
+		rules_.insert(rule_hash_[i], i);
+}
+
+void
+Population::reserve(size_t n) {
+	if (binary_) {
+		care_.reserve(n * words_);
+		value_.reserve(n * words_);
+	} else {
+		lower_.reserve(n * len_);
+		upper_.reserve(n * len_);
+	}
+	if (match_index())
+		index_.reserve(n);
+	rules_.reserve(n);
+	wheel_.reserve(n);
+	act_.reserve(n);
+	prediction_.reserve(n);
+	prediction_error_.reserve(n);
+	fitness_.reserve(n);
+	experience_.reserve(n);
+	actionset_size_.reserve(n);
+	numerosity_.reserve(n);
+	disproving_.reserve(n);
+	disproves_.reserve(n);
+	id_.reserve(n);
+	stamp_.reserve(n);
+	cond_key_.reserve(n);
+	rule_hash_.reserve(n);
+}
+
+size_t
+Population::storage_capacity() const {
+	return lower_.capacity() + upper_.capacity() + care_.capacity() + value_.capacity() + act_.capacity() +
+	       prediction_.capacity() + prediction_error_.capacity() + fitness_.capacity() + experience_.capacity() +
+	       actionset_size_.capacity() + numerosity_.capacity() + disproving_.capacity() + disproves_.capacity() +
+	       id_.capacity() + stamp_.capacity() + cond_key_.capacity() + rule_hash_.capacity() +
+	       index_.allocated_words() + rules_.allocated_entries() + wheel_.allocated_entries();
+}
+
+void
+Population::begin_push(size_t len) {
+	if (empty()) {
+		len_ = len;
+		words_ = (len + 63) / 64;
+		index_.reset(len_);
+		reserve(act_.capacity());
+	}
+	assert(len == len_);
+}
+
+void
+Population::push_parameters(const Classifier& cl) {
+	act_.push_back(cl.rule.act);
+	prediction_.push_back(cl.prediction);
+	prediction_error_.push_back(cl.prediction_error);
+	fitness_.push_back(cl.fitness);
+	experience_.push_back(cl.experience);
+	actionset_size_.push_back(cl.actionset_size);
+	numerosity_.push_back(cl.numerosity);
+	disproving_.push_back(cl.disproving);
+	disproves_.push_back(cl.disproves);
+	id_.push_back(next_id());
+	stamp_.push_back(++clock_);
+	cond_key_.push_back(condition_key(size() - 1));
+	rule_hash_.push_back(rule_hash(size() - 1));
+	end_push();
+}
+
+uint64_t
+Population::condition_key(size_t i) const {
+	uint64_t key = 0;
+	if (binary_) {
+		// '0', '1' and '#' of the first 32 positions as 0, 1 and 2
+		for (size_t k = 0; k < 32; k++) {
+			const uint64_t bit = (uint64_t) 1 << (k % 64);
+			const uint64_t digit = k >= len_ ? 0 : !(care(i)[k / 64] & bit) ? 2 : (value(i)[k / 64] & bit) ? 1 : 0;
+			key = (key << 2) | digit;
+		}
+		return key;
+	}
+	// the lower and upper bound of the first 4 dimensions
+	for (size_t k = 0; k < 4; k++) {
+		key = (key << 8) | (k < len_ ? quantise_bound(lower(i)[k]) : 0);
+		key = (key << 8) | (k < len_ ? quantise_bound(upper(i)[k]) : 0);
+	}
+	return key;
+}
+
+uint64_t
+Population::rule_hash(size_t i) const {
+	uint64_t hash = hash_id(act_[i]);
+	if (binary_) {
+		for (size_t w = 0; w < words_; w++)
+			hash = mix(mix(hash, care(i)[w]), value(i)[w]);
+	} else {
+		for (size_t k = 0; k < len_; k++)
+			hash = mix(mix(hash, bound_bits(lower(i)[k])), bound_bits(upper(i)[k]));
+	}
+	return hash;
+}
+
+size_t
+Population::find_rule(const Rule& rule) const {
+	if (empty() || rule.elements.size() != 2 * len_)
+		return size();
+
+	uint64_t hash = hash_id(rule.act);
+	if (binary_) {
+		for (size_t w = 0; w < words_; w++) {
+			uint64_t care = 0;
+			uint64_t value = 0;
+			for (size_t k = 64 * w; k < len_ && k < 64 * (w + 1); k++) {
+				const double lo = rule.elements[2*k];
+				const double hi = rule.elements[2*k+1];
+				const uint64_t bit = (uint64_t) 1 << (k % 64);
+				if (lo == hi && (lo == 0.0 || lo == 1.0)) {
+					care |= bit;
+					if (lo == 1.0)
+						value |= bit;
+				} else if (lo != 0.0 || hi != 1.0) {
+					// no ternary condition has these bounds
+					return size();
+				}
+			}
+			hash = mix(mix(hash, care), value);
+		}
+	} else {
+		for (size_t k = 0; k < len_; k++)
+			hash = mix(mix(hash, bound_bits(rule.elements[2*k])), bound_bits(rule.elements[2*k+1]));
+	}
+	const size_t i = rules_.find(hash, [&](size_t c) { return same_rule(c, rule); });
+	return i == SIZE_MAX ? size() : i;
+}
+
+/// Adds the last classifier to the wheel, the rule index and the totals
+void
+Population::end_push() {
+	const size_t i = size() - 1;
+	wheel_.push_back(actionset_size_[i], numerosity_[i], fitness_[i], experience_[i]);
+	// grow the rule index along with the columns
+	rules_.reserve(act_.capacity());
+	rules_.insert(rule_hash_[i], i);
+	add_to_totals(i);
+}
+
+size_t
+Population::push_back(const Classifier& cl) {
+	const size_t capacity = storage_capacity();
+	const size_t len = cl.rule.elements.size() / 2;
+	begin_push(len);
+
+	if (binary_) {
+		for (size_t w = 0; w < words_; w++) {
+			uint64_t care = 0;
+			uint64_t value = 0;
+			for (size_t k = 64 * w; k < len && k < 64 * (w + 1); k++) {
+				const uint64_t bit = (uint64_t) 1 << (k % 64);
+				if (cl.rule.elements[2*k] == cl.rule.elements[2*k+1]) {
+					care |= bit;
+					if (cl.rule.elements[2*k] == 1.0)
+						value |= bit;
+				}
+			}
+			care_.push_back(care);
+			value_.push_back(value);
+		}
+		if (indexed_)
+			index_.push_back(care(size()), value(size()));
+	} else {
+		for (size_t k = 0; k < len; k++)
+			lower_.push_back(cl.rule.elements[2*k]);
+		for (size_t k = 0; k < len; k++)
+			upper_.push_back(cl.rule.elements[2*k+1]);
+	}
+	push_parameters(cl);
+
+	if (storage_capacity() != capacity)
+		allocations_++;
+	return size() - 1;
+}
+
+size_t
+Population::push_back(const Input& input, Action act) {
+	assert(input.binary == binary_);
+	const size_t capacity = storage_capacity();
+	begin_push(input.len);
+
+	if (binary_) {
+		for (size_t w = 0; w < words_; w++) {
+			const size_t bits = std::min<size_t>(64, len_ - 64 * w);
+			const uint64_t care = bits == 64 ? ~(uint64_t) 0 : ((uint64_t) 1 << bits) - 1;
+			care_.push_back(care);
+			value_.push_back(input.bits[w] & care);
+		}
+		if (indexed_)
+			index_.push_back(care(size()), value(size()));
+	} else {
+		lower_.insert(lower_.end(), input.values.begin(), input.values.end());
+		upper_.insert(upper_.end(), input.values.begin(), input.values.end());
+	}
+	Classifier cl;
+	cl.rule.act = act;
+	push_parameters(cl);
+
+	if (storage_capacity() != capacity)
+		allocations_++;
+	return size() - 1;
+}
+
+size_t
+Population::push_back(const Population& other, size_t i) {
+	assert(other.binary_ == binary_);
+	const size_t capacity = storage_capacity();
+	begin_push(other.len_);
+
+	if (binary_) {
+		care_.insert(care_.end(), other.care(i), other.care(i) + words_);
+		value_.insert(value_.end(), other.value(i), other.value(i) + words_);
+		if (indexed_)
+			index_.push_back(care(size()), value(size()));
+	} else {
+		lower_.insert(lower_.end(), other.lower(i), other.lower(i) + len_);
+		upper_.insert(upper_.end(), other.upper(i), other.upper(i) + len_);
+	}
+	act_.push_back(other.act_[i]);
+	prediction_.push_back(other.prediction_[i]);
+	prediction_error_.push_back(other.prediction_error_[i]);
+	fitness_.push_back(other.fitness_[i]);
+	experience_.push_back(other.experience_[i]);
+	actionset_size_.push_back(other.actionset_size_[i]);
+	numerosity_.push_back(other.numerosity_[i]);
+	disproving_.push_back(other.disproving_[i]);
+	disproves_.push_back(other.disproves_[i]);
+	id_.push_back(other.id_[i]);
+	stamp_.push_back(other.stamp_[i]);
+	cond_key_.push_back(other.cond_key_[i]);
+	rule_hash_.push_back(other.rule_hash_[i]);
+	clock_ = std::max(clock_, other.clock_);
+	end_push();
+
+	if (storage_capacity() != capacity)
+		allocations_++;
+	return size() - 1;
+}
+
+void
+Population::erase(size_t i) {
+	assert(i < size());
+	kept_.clear();
+	for (size_t k = 0; k < size(); k++)
+		if (k != i)
+			kept_.push_back(k);
+	remove_from_totals(i);
+	compact();
+}
+
+void
+Population::erase(const ClassifierSet& victims) {
+	assert(std::adjacent_find(victims.begin(), victims.end(), std::greater_equal<size_t>()) == victims.end());
+	kept_.clear();
+	auto victim = victims.begin();
+	for (size_t k = 0; k < size(); k++) {
+		if (victim != victims.end() && *victim == k) {
+			remove_from_totals(k);
+			victim++;
+		} else {
+			kept_.push_back(k);
+		}
+	}
+	assert(victim == victims.end());
+	if (!victims.empty())
+		compact();
+}
+
+void
+Population::swap_erase(size_t i) {
+	assert(i < size());
+	generation_++;
+	remove_from_totals(i);
+	wheel_.swap_erase(i);
+	if (binary_) {
+		move_last_row(care_, i, words_);
+		move_last_row(value_, i, words_);
+		if (indexed_)
+			index_.swap_erase(i);
+	} else {
+		move_last_row(lower_, i, len_);
+		move_last_row(upper_, i, len_);
+	}
+	move_last(act_, i);
+	move_last(prediction_, i);
+	move_last(prediction_error_, i);
+	move_last(fitness_, i);
+	move_last(experience_, i);
+	move_last(actionset_size_, i);
+	move_last(numerosity_, i);
+	move_last(disproving_, i);
+	move_last(disproves_, i);
+	move_last(id_, i);
+	move_last(stamp_, i);
+	move_last(cond_key_, i);
+	rules_.erase(rule_hash_[i], i);
+	if (i + 1 < rule_hash_.size())
+		rules_.move(rule_hash_.back(), rule_hash_.size() - 1, i);
+	move_last(rule_hash_, i);
+}
+
+size_t
+Population::erase_inexperienced() {
+	kept_.clear();
+	for (size_t i = 0; i < size(); i++) {
+		if (experience_[i] > 0)
+			kept_.push_back(i);
+		else
+			remove_from_totals(i);
+	}
+	const size_t removed = size() - kept_.size();
+	if (removed > 0)
+		compact();
+	return removed;
+}
+
+void
+Population::compact() {
+	generation_++;
+	if (binary_) {
+		compact_rows(care_, kept_, words_);
+		compact_rows(value_, kept_, words_);
+	} else {
+		compact_rows(lower_, kept_, len_);
+		compact_rows(upper_, kept_, len_);
+	}
+	compact_column(act_, kept_);
+	compact_column(prediction_, kept_);
+	compact_column(prediction_error_, kept_);
+	compact_column(fitness_, kept_);
+	compact_column(experience_, kept_);
+	compact_column(actionset_size_, kept_);
+	compact_column(numerosity_, kept_);
+	compact_column(disproving_, kept_);
+	compact_column(disproves_, kept_);
+	compact_column(id_, kept_);
+	compact_column(stamp_, kept_);
+	compact_column(cond_key_, kept_);
+	compact_column(rule_hash_, kept_);
+	rebuild_rules();
+	if (match_index())
+		rebuild_index();
+	wheel_.assign(actionset_size_.data(), numerosity_.data(), fitness_.data(), experience_.data(), size());
+}
+
+void
+Population::permute(const vector<size_t>& order) {
+	assert(order.size() == size());
+	generation_++;
+	if (binary_) {
+		permute_rows(care_, order, words_, spare_);
+		permute_rows(value_, order, words_, spare_);
+	} else {
+		permute_rows(lower_, order, len_, spare_);
+		permute_rows(upper_, order, len_, spare_);
+	}
+	permute_column(act_, order, spare_);
+	permute_column(prediction_, order, spare_);
+	permute_column(prediction_error_, order, spare_);
+	permute_column(fitness_, order, spare_);
+	permute_column(experience_, order, spare_);
+	permute_column(actionset_size_, order, spare_);
+	permute_column(numerosity_, order, spare_);
+	permute_column(disproving_, order, spare_);
+	permute_column(disproves_, order, spare_);
+	permute_column(id_, order, spare_);
+	permute_column(stamp_, order, spare_);
+	permute_column(cond_key_, order, spare_);
+	permute_column(rule_hash_, order, spare_);
+	rebuild_rules();
+	if (match_index())
+		rebuild_index();
+	wheel_.assign(actionset_size_.data(), numerosity_.data(), fitness_.data(), experience_.data(), size());
+}
+
+void
+Population::update_wheel(size_t i) {
+	wheel_.update(i, actionset_size_[i], numerosity_[i], fitness_[i], experience_[i]);
+}
+
+void
+Population::add_to_totals(size_t i) {
+	total_numerosity_ += numerosity_[i];
+	experienced_ += experience_[i] > 0;
+	total_experience_ += experience_[i];
+}
+
+void
+Population::remove_from_totals(size_t i) {
+	total_numerosity_ -= numerosity_[i];
+	experienced_ -= experience_[i] > 0;
+	total_experience_ -= experience_[i];
+}
+
+void
+Population::set_fitness(size_t i, double fitness) {
+	fitness_[i] = fitness;
+	update_wheel(i);
+}
+
+void
+Population::set_prediction(size_t i, double prediction) {
+	if (prediction_[i] != prediction)
+		stamp_[i] = ++clock_;
+	prediction_[i] = prediction;
+}
+
+void
+Population::set_experience(size_t i, unsigned int experience) {
+	const unsigned int old = experience_[i];
+	if ((old >= 1) != (experience >= 1) || (old >= MIN_EXP) != (experience >= MIN_EXP))
+		stamp_[i] = ++clock_;
+	remove_from_totals(i);
+	experience_[i] = experience;
+	add_to_totals(i);
+	update_wheel(i);
+}
+
+void
+Population::set_actionset_size(size_t i, double actionset_size) {
+	actionset_size_[i] = actionset_size;
+	update_wheel(i);
+}
+
+void
+Population::set_numerosity(size_t i, unsigned int numerosity) {
+	if (numerosity_[i] != numerosity)
+		stamp_[i] = ++clock_;
+	remove_from_totals(i);
+	numerosity_[i] = numerosity;
+	add_to_totals(i);
+	update_wheel(i);
+}
+
+void
+Population::set_learned(size_t i, unsigned int experience, double prediction, double prediction_error,
+                        double actionset_size, double fitness) {
+	const unsigned int old = experience_[i];
+	if (prediction_[i] != prediction || (old >= 1) != (experience >= 1) || (old >= MIN_EXP) != (experience >= MIN_EXP))
+		stamp_[i] = ++clock_;
+	remove_from_totals(i);
+	experience_[i] = experience;
+	add_to_totals(i);
+	prediction_[i] = prediction;
+	prediction_error_[i] = prediction_error;
+	actionset_size_[i] = actionset_size;
+	fitness_[i] = fitness;
+	update_wheel(i);
+}
+
+Classifier
+Population::get(size_t i) const {
+	Classifier cl;
+	cl.rule.elements.resize(2 * len_);
+	for (size_t k = 0; k < len_; k++) {
+		if (binary_) {
+			const uint64_t bit = (uint64_t) 1 << (k % 64);
+			const double v = (value(i)[k / 64] & bit) ? 1.0 : 0.0;
+			const bool cares = care(i)[k / 64] & bit;
+			cl.rule.elements[2*k] = cares ? v : 0.0;
+			cl.rule.elements[2*k+1] = cares ? v : 1.0;
+		} else {
+			cl.rule.elements[2*k] = lower(i)[k];
+			cl.rule.elements[2*k+1] = upper(i)[k];
+		}
+	}
+	cl.rule.act = act_[i];
+	cl.prediction = prediction_[i];
+	cl.prediction_error = prediction_error_[i];
+	cl.fitness = fitness_[i];
+	cl.experience = experience_[i];
+	cl.actionset_size = actionset_size_[i];
+	cl.numerosity = numerosity_[i];
+	cl.disproving = disproving_[i];
+	cl.disproves = disproves_[i] != 0;
+	return cl;
+}
+
+bool
+Population::same_rule(size_t i, size_t j) const {
+	if (binary_)
+		return act_[i] == act_[j] && std::equal(care(i), care(i) + words_, care(j)) &&
+		       std::equal(value(i), value(i) + words_, value(j));
+	return act_[i] == act_[j] && std::equal(lower(i), lower(i) + len_, lower(j)) &&
+	       std::equal(upper(i), upper(i) + len_, upper(j));
+}
+
+bool
+Population::same_rule(size_t i, const Rule& rule) const {
+	if (act_[i] != rule.act || rule.elements.size() != 2 * len_)
+		return false;
+	for (size_t k = 0; k < len_; k++) {
+		double lo = 0.0;
+		double hi = 0.0;
+		if (binary_) {
+			const uint64_t bit = (uint64_t) 1 << (k % 64);
+			const double v = (value(i)[k / 64] & bit) ? 1.0 : 0.0;
+			const bool cares = care(i)[k / 64] & bit;
+			lo = cares ? v : 0.0;
+			hi = cares ? v : 1.0;
+		} else {
+			lo = lower(i)[k];
+			hi = upper(i)[k];
+		}
+		if (lo != rule.elements[2*k] || hi != rule.elements[2*k+1])
+			return false;
+	}
+	return true;
+}
@@ -0,0 +1,99 @@
+#include <rejected_pairs.hpp>
+
+#include <algorithm>
+
+#include "id_hash.hpp"
+
+void
+RejectedPairs::clear() {
+	size_ = 0;
+	std::fill(entries_.begin(), entries_.end(), Entry{0, 0, 0, 0});
+	witnesses_ = 0;
+	std::fill(heads_.begin(), heads_.end(), Head{0, 0});
+	links_.clear();
+}
+
+RejectedPairs::Entry*
+RejectedPairs::find(uint64_t a, uint64_t b) {
+	if (size_ == 0)
+		return nullptr;
+	const uint64_t first = std::min(a, b);
+	const uint64_t second = std::max(a, b);
+	const size_t mask = entries_.size() - 1;
+	for (size_t slot = hash_pair(first, second) & mask; entries_[slot].first != 0; slot = (slot + 1) & mask)
+		if (entries_[slot].first == first && entries_[slot].second == second)
+			return &entries_[slot];
+	return nullptr;
+}
+
+void
+RejectedPairs::insert(uint64_t a, uint64_t b, uint64_t witness, size_t added) {
+	if (2 * (size_ + 1) > entries_.size()) {
+		spare_.assign(table_size(size_ + 1), Entry{0, 0, 0, 0});
+		const size_t mask = spare_.size() - 1;
+		for (const Entry& entry : entries_) {
+			if (entry.first == 0)
+				continue;
+			size_t slot = hash_pair(entry.first, entry.second) & mask;
+			while (spare_[slot].first != 0)
+				slot = (slot + 1) & mask;
+			spare_[slot] = entry;
+		}
+		entries_.swap(spare_);
+	}
+	const uint64_t first = std::min(a, b);
+	const uint64_t second = std::max(a, b);
+	const size_t mask = entries_.size() - 1;
+	size_t slot = hash_pair(first, second) & mask;
+	for (; entries_[slot].first != 0; slot = (slot + 1) & mask)
+		if (entries_[slot].first == first && entries_[slot].second == second)
+			break;
+	if (entries_[slot].first == 0)
+		size_++;
+	entries_[slot] = Entry{first, second, witness, added};
+
+	Head& chain = head(witness);
+	links_.push_back(Link{first, second, chain.link});
+	chain.link = links_.size();
+}
+
+void
+RejectedPairs::witnessed(uint64_t witness, vector<Entry>& out) {
+	if (witnesses_ == 0)
+		return;
+	const size_t mask = heads_.size() - 1;
+	size_t slot = hash_id(witness) & mask;
+	for (; heads_[slot].witness != witness; slot = (slot + 1) & mask)
+		if (heads_[slot].witness == 0)
+			return;
+	for (size_t link = heads_[slot].link; link != 0; link = links_[link - 1].next) {
+		const Entry* entry = find(links_[link - 1].first, links_[link - 1].second);
+		if (entry->witness == witness)
+			out.push_back(*entry);
+	}
+}
+
+RejectedPairs::Head&
+RejectedPairs::head(uint64_t witness) {
+	if (2 * (witnesses_ + 1) > heads_.size()) {
+		spare_heads_.assign(table_size(witnesses_ + 1), Head{0, 0});
+		const size_t mask = spare_heads_.size() - 1;
+		for (const Head& chain : heads_) {
+			if (chain.witness == 0)
+				continue;
+			size_t slot = hash_id(chain.witness) & mask;
+			while (spare_heads_[slot].witness != 0)
+				slot = (slot + 1) & mask;
+			spare_heads_[slot] = chain;
+		}
+		heads_.swap(spare_heads_);
+	}
+	const size_t mask = heads_.size() - 1;
+	size_t slot = hash_id(witness) & mask;
+	for (; heads_[slot].witness != 0; slot = (slot + 1) & mask)
+		if (heads_[slot].witness == witness)
+			return heads_[slot];
+	witnesses_++;
+	heads_[slot] = Head{witness, 0};
+	return heads_[slot];
+}
@@ -0,0 +1,78 @@
+#include <rule_index.hpp>
+
+#include <algorithm>
+#include <cassert>
+
+#include "id_hash.hpp"
+
+void
+RuleIndex::clear() {
+	size_ = 0;
+	std::fill(slots_.begin(), slots_.end(), Slot{0, SIZE_MAX});
+}
+
+void
+RuleIndex::reserve(size_t n) {
+	if (2 * n > slots_.size())
+		rehash(n);
+}
+
+void
+RuleIndex::rehash(size_t n) {
+	spare_.assign(table_size(n), Slot{0, SIZE_MAX});
+	const size_t mask = spare_.size() - 1;
+	for (const Slot& entry : slots_) {
+		if (entry.index == SIZE_MAX)
+			continue;
+		size_t slot = entry.hash & mask;
+		while (spare_[slot].index != SIZE_MAX)
+			slot = (slot + 1) & mask;
+		spare_[slot] = entry;
+	}
+	slots_.swap(spare_);
+}
+
+void
+RuleIndex::insert(uint64_t hash, size_t i) {
+	if (2 * (size_ + 1) > slots_.size())
+		rehash(size_ + 1);
+	const size_t mask = slots_.size() - 1;
+	size_t slot = hash & mask;
+	while (slots_[slot].index != SIZE_MAX)
+		slot = (slot + 1) & mask;
+	slots_[slot] = Slot{hash, i};
+	size_++;
+}
+
+size_t
+RuleIndex::slot_of(uint64_t hash, size_t i) const {
+	const size_t mask = slots_.size() - 1;
+	size_t slot = hash & mask;
+	while (slots_[slot].index != i) {
+		assert(slots_[slot].index != SIZE_MAX);
+		slot = (slot + 1) & mask;
+	}
+	return slot;
+}
+
+void
+RuleIndex::erase(uint64_t hash, size_t i) {
+	const size_t mask = slots_.size() - 1;
+	size_t gap = slot_of(hash, i);
+	// move later entries of the probe sequence back into the gap, so that
+	// lookups need no tombstones
+	for (size_t slot = (gap + 1) & mask; slots_[slot].index != SIZE_MAX; slot = (slot + 1) & mask) {
+		const size_t home = slots_[slot].hash & mask;
+		if (((slot - home) & mask) >= ((slot - gap) & mask)) {
+			slots_[gap] = slots_[slot];
+			gap = slot;
+		}
+	}
+	slots_[gap] = Slot{0, SIZE_MAX};
+	size_--;
+}
+
+void
+RuleIndex::move(uint64_t hash, size_t from, size_t to) {
+	slots_[slot_of(hash, from)].index = to;
+}
@@ -0,0 +1,113 @@
+#include <update_kernels.hpp>
+
+#include <cmath>
+
+#include "constants.h"
+
+namespace {
+
+/// (1 - BETA)^n for every n it is a normal number at, computed by pow so that
+/// it matches the values pow gave before
+vector<double>
+beta_decay_table() {
+	vector<double> table;
+	for (double d = 1; std::isnormal(d); d = std::pow(1 - BETA, table.size()))
+		table.push_back(d);
+	return table;
+}
+
+} // namespace
+
+double
+beta_decay(unsigned int n) {
+	static const vector<double> table = beta_decay_table();
+	return n < table.size() ? table[n] : std::pow(1 - BETA, n);
+}
+
+void
+ActionSetView::gather(const Population& pop, const ClassifierSet& action_set) {
+	const size_t n = action_set.size();
+	experience.resize(n);
+	prediction.resize(n);
+	prediction_error.resize(n);
+	actionset_size.resize(n);
+	numerosity.resize(n);
+	fitness.resize(n);
+	accuracy.resize(n);
+	erroneous.resize(n);
+	for (size_t k = 0; k < n; k++) {
+		const size_t cl = action_set[k];
+		experience[k] = pop.experience(cl);
+		prediction[k] = pop.prediction(cl);
+		prediction_error[k] = pop.prediction_error(cl);
+		actionset_size[k] = pop.actionset_size(cl);
+		numerosity[k] = pop.numerosity(cl);
+		fitness[k] = pop.fitness(cl);
+	}
+}
+
+void
+ActionSetView::scatter(Population& pop, const ClassifierSet& action_set) const {
+	for (size_t k = 0; k < action_set.size(); k++)
+		pop.set_learned(action_set[k], experience[k], prediction[k], prediction_error[k], actionset_size[k],
+		                fitness[k]);
+}
+
+double
+update_action_set(ActionSetView& view, double reward, double total_numerosity) {
+	const size_t n = view.size();
+	unsigned int* experience = view.experience.data();
+	double* prediction = view.prediction.data();
+	double* prediction_error = view.prediction_error.data();
+	double* actionset_size = view.actionset_size.data();
+	const double* numerosity = view.numerosity.data();
+	double* accuracy = view.accuracy.data();
+	char* erroneous = view.erroneous.data();
+
+	// the selects of the learning rate compute both sides, so they compile to
+	// blends instead of branches
+	double accuracy_sum = 0;
+	for (size_t k = 0; k < n; k++) {
+		const unsigned int exp = experience[k] + 1;
+		const double e = exp;
+		const bool averaging = exp < 1 / BETA;
+		experience[k] = exp;
+
+		const double p = prediction[k];
+		const double p_new = averaging ? p + (reward - p) / e : p + BETA * (reward - p);
+		prediction[k] = p_new;
+
+		const double as = actionset_size[k];
+		actionset_size[k] = averaging ? as + (total_numerosity - as) / e : as + (total_numerosity - as);
+
+		const double err = prediction_error[k];
+		const double miss = std::abs(reward - p_new) - err;
+		const double err_new = averaging ? err + miss / e : err + BETA * miss;
+		prediction_error[k] = err_new;
+		erroneous[k] = exp >= 2 * MIN_EXP && err <= PRED_ERR_TOL && err_new > PRED_ERR_TOL;
+
+		accuracy[k] = accuracy_of(err_new);
+		accuracy_sum += accuracy[k] * numerosity[k];
+	}
+	return accuracy_sum;
+}
+
+double
+update_accuracy(ActionSetView& view) {
+	double accuracy_sum = 0;
+	for (size_t k = 0; k < view.size(); k++) {
+		view.accuracy[k] = accuracy_of(view.prediction_error[k]);
+		accuracy_sum += view.accuracy[k] * view.numerosity[k];
+	}
+	return accuracy_sum;
+}
+
+void
+update_fitness(ActionSetView& view, double accuracy_sum) {
+	const size_t n = view.size();
+	const double* accuracy = view.accuracy.data();
+	const double* numerosity = view.numerosity.data();
+	double* fitness = view.fitness.data();
+	for (size_t k = 0; k < n; k++)
+		fitness[k] = fitness[k] + BETA * ((accuracy[k] * numerosity[k]) / accuracy_sum - fitness[k]);
+}
@@ -1,23 +1,159 @@
 #include <utils.hpp>
 
+#include <memory>
+#include <mutex>
 #include <random>
+#include <vector>
+
+namespace {
+
+uint64_t
+rotl(uint64_t x, int k) {
+	return (x << k) | (x >> (64 - k));
+}
+
+uint64_t
+splitmix64(uint64_t& x) {
+	uint64_t z = (x += 0x9e3779b97f4a7c15);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+	return z ^ (z >> 31);
+}
+
+/// Advances a xoshiro256 state by one draw
+void
+step(uint64_t s[4]) {
+	const uint64_t t = s[1] << 17;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotl(s[3], 45);
+}
+
+/// Advances a xoshiro256 state by 2^128 draws
+void
+jump_state(uint64_t s[4]) {
+	static const uint64_t JUMP[] = {0x180ec6d33cfd0aba, 0xd5a61266f0c9392c, 0xa9582618e03fc9aa, 0x39abdc4529b1661c};
+	uint64_t jumped[4] = {0, 0, 0, 0};
+	for (uint64_t jump : JUMP)
+		for (int b = 0; b < 64; b++) {
+			if (jump & ((uint64_t) 1 << b))
+				for (int k = 0; k < 4; k++)
+					jumped[k] ^= s[k];
+			step(s);
+		}
+	for (int k = 0; k < 4; k++)
+		s[k] = jumped[k];
+}
+
+/// A number of jumps, which is a linear map of the state over GF(2). Column
+/// j holds the image of state bit j.
+struct JumpMatrix {
+	uint64_t columns[256][4];
+
+	/// Applies the jumps to state s
+	void apply(uint64_t s[4]) const {
+		uint64_t image[4] = {0, 0, 0, 0};
+		for (int j = 0; j < 256; j++)
+			if ((s[j / 64] >> (j % 64)) & 1)
+				for (int k = 0; k < 4; k++)
+					image[k] ^= columns[j][k];
+		for (int k = 0; k < 4; k++)
+			s[k] = image[k];
+	}
+};
+
+/// Returns the matrix of 2^k jumps. The matrices are built on first use,
+/// the one of a single jump from its images of the state bits, every further
+/// one by squaring the one before.
+const JumpMatrix&
+jump_power(size_t k) {
+	static std::mutex mutex;
+	static std::vector<std::unique_ptr<JumpMatrix>> powers;
+	std::lock_guard<std::mutex> lock(mutex);
+	if (powers.empty()) {
+		powers.emplace_back(new JumpMatrix);
+		for (int j = 0; j < 256; j++) {
+			uint64_t* column = powers.back()->columns[j];
+			for (int w = 0; w < 4; w++)
+				column[w] = w == j / 64 ? (uint64_t) 1 << (j % 64) : 0;
+			jump_state(column);
+		}
+	}
+	while (powers.size() <= k) {
+		const JumpMatrix& last = *powers.back();
+		JumpMatrix* squared = new JumpMatrix(last);
+		for (int j = 0; j < 256; j++)
+			last.apply(squared->columns[j]);
+		powers.emplace_back(squared);
+	}
+	return *powers[k];
+}
+
+Rng&
+thread_rng() {
+	thread_local Rng rng(std::random_device{}());
+	return rng;
+}
+
+} // namespace
+
+Rng::Rng(uint64_t seed, uint64_t stream) {
+	this->seed(seed, stream);
+}
+
+void
+Rng::seed(uint64_t seed, uint64_t stream) {
+	for (uint64_t& s : s_)
+		s = splitmix64(seed);
+	// stream jumps, made of the powers of two they add up to
+	for (size_t k = 0; k < 64 && (stream >> k) != 0; k++)
+		if ((stream >> k) & 1)
+			jump_power(k).apply(s_);
+}
+
+uint64_t
+Rng::next() {
+	const uint64_t result = rotl(s_[1] * 5, 7) * 9;
+	step(s_);
+	return result;
+}
 
 double
-random_number(const double min, const double max) {
-	std::random_device rd;
-	std::mt19937 gen(rd());
-	std::uniform_real_distribution<double> dis(min, max);
+Rng::uniform(double min, double max) {
+	// the upper 53 bits give a double in [0, 1)
+	const double unit = (next() >> 11) * (1.0 / 9007199254740992.0);
+	return min + unit * (max - min);
+}
 
-	return dis(gen);
+unsigned
+Rng::uniform_uint(unsigned min, unsigned max) {
+	const uint64_t range = (uint64_t) max - min + 1;
+	// Lemire's multiply and reject, unbiased for every range
+	uint64_t m = (next() >> 32) * range;
+	if ((uint32_t) m < range) {
+		const uint32_t threshold = (uint32_t) ((((uint64_t) 1 << 32) - range) % range);
+		while ((uint32_t) m < threshold)
+			m = (next() >> 32) * range;
+	}
+	return min + (unsigned) (m >> 32);
+}
+
+void
+Rng::jump() {
+	jump_state(s_);
+}
+
+double
+random_number(const double min, const double max) {
+	return thread_rng().uniform(min, max);
 }
 
 unsigned
 random_uint(const unsigned min, const unsigned max) {
-	std::random_device rd;
-	std::mt19937 gen(rd());
-	std::uniform_int_distribution<unsigned int> dis(min, max);
-
-	return dis(gen);
+	return thread_rng().uniform_uint(min, max);
 }
 
 bool
@@ -1,12 +1,17 @@
 #include <cassert>
 #include <cmath>
+#include <cstring>
 #include <iomanip> // std::setprecision
 #include <iterator>
+#include <numeric>
+#include <thread>
 #include <utility> // for std::pair
 #include <vector>
 #include <stdlib.h>
 #include <boost/tokenizer.hpp>
 
+#include <match_kernels.hpp>
+#include <overlap_index.hpp>
 #include <utils.hpp>
 #include <xcs.hpp>
 
@@ -21,16 +26,10 @@ within_range(double v1, double v2, double tolerance) {
 }
 
 clexp
-get_exp_classifiers(const ClassifierSet& set) {
+get_exp_classifiers(const Population& pop) {
 	clexp value;
-	unsigned int num = 0, tot = 0;
-	for (const auto& c: set)
-		if (c->experience > 0) {
-			num++;
-			tot += c->experience;
-		}
-	value.cl_exp = num;
-	value.tot_exp = tot;
+	value.cl_exp = pop.experienced();
+	value.tot_exp = pop.total_experience();
 	return value;
 }
 
@@ -79,6 +78,37 @@ elements_match(const vector<double>& elements, const vector<double>& input) {
 	return true;
 }
 
+/// Returns true if the deinterleaved bounds of a condition match on data
+bool
+bounds_match(const double* lower, const double* upper, const double* input, size_t len) {
+	for (size_t i = 0; i < len; i++) {
+		if (lower[i] > input[i] || upper[i] < input[i])
+			return false;
+	}
+	return true;
+}
+
+/// Returns true if a ternary condition given by care and value masks matches
+/// on packed input bits
+bool
+bits_match(const uint64_t* care, const uint64_t* value, const uint64_t* input, size_t words) {
+	for (size_t w = 0; w < words; w++) {
+		if ((input[w] ^ value[w]) & care[w])
+			return false;
+	}
+	return true;
+}
+
+/// Returns true if the condition of classifier cl matches on the input
+bool
+classifier_matches(const Population& pop, size_t cl, const Input& input) {
+	if (pop.cond_len() != input.len || pop.binary() != input.binary)
+		return false;
+	if (pop.binary())
+		return bits_match(pop.care(cl), pop.value(cl), input.bits.data(), pop.cond_words());
+	return bounds_match(pop.lower(cl), pop.upper(cl), input.values.data(), input.len);
+}
+
 /// Returns true if the conditions can match at least one point
 int
 count_overlap(const vector<double>& elements1, const vector<double>& elements2) {
@@ -106,6 +136,104 @@ elements_overlap(const vector<double>& elements1, const vector<double>& elements
 	return (count == len);
 }
 
+/// Returns true if two conditions given by their deinterleaved bounds can
+/// match at least one point
+bool
+bounds_overlap(const double* lower1, const double* upper1, const double* lower2, const double* upper2, size_t len) {
+	for (size_t i = 0; i < len; i++) {
+		if (lower1[i] > upper2[i] || lower2[i] > upper1[i])
+			return false;
+	}
+	return true;
+}
+
+/// Returns true if the bounds of the subsumer contain the bounds of a condition
+bool
+bounds_subsume(const double* sub_lower, const double* sub_upper, const double* lower, const double* upper, size_t len) {
+	for (size_t i = 0; i < len; i++)
+		if (sub_lower[i] > lower[i] || sub_upper[i] < upper[i]) return false;
+	return true;
+}
+
+/// Returns true if two ternary conditions can match at least one input
+bool
+bits_overlap(const uint64_t* care1, const uint64_t* value1, const uint64_t* care2, const uint64_t* value2, size_t words) {
+	for (size_t w = 0; w < words; w++)
+		if ((value1[w] ^ value2[w]) & care1[w] & care2[w]) return false;
+	return true;
+}
+
+/// Returns true if the ternary subsumer matches every input the condition matches
+bool
+bits_subsume(const uint64_t* sub_care, const uint64_t* sub_value, const uint64_t* care, const uint64_t* value, size_t words) {
+	for (size_t w = 0; w < words; w++)
+		if ((sub_care[w] & ~care[w]) || ((sub_value[w] ^ value[w]) & sub_care[w])) return false;
+	return true;
+}
+
+/// Sets cond to the most specific condition covering classifiers i and j
+void
+combine_conditions(const Population& pop, size_t i, size_t j, Condition& cond) {
+	if (pop.binary()) {
+		const size_t words = pop.cond_words();
+		cond.care.resize(words);
+		cond.value.resize(words);
+		for (size_t w = 0; w < words; w++) {
+			cond.care[w] = pop.care(i)[w] & pop.care(j)[w] & ~(pop.value(i)[w] ^ pop.value(j)[w]);
+			cond.value[w] = pop.value(i)[w] & cond.care[w];
+		}
+		return;
+	}
+
+	const size_t len = pop.cond_len();
+	const double* lower1 = pop.lower(i);
+	const double* upper1 = pop.upper(i);
+	const double* lower2 = pop.lower(j);
+	const double* upper2 = pop.upper(j);
+	cond.lower.resize(len);
+	cond.upper.resize(len);
+	for (size_t k=0; k<len; k++) {
+		cond.lower[k] = (lower1[k]<lower2[k])?lower1[k]:lower2[k];
+		cond.upper[k] = (upper1[k]>upper2[k])?upper1[k]:upper2[k];
+	}
+}
+
+/// Returns true if cond and the condition of classifier cl can match at least one point
+bool
+condition_overlaps(const Population& pop, const Condition& cond, size_t cl) {
+	if (pop.binary())
+		return bits_overlap(cond.care.data(), cond.value.data(), pop.care(cl), pop.value(cl), pop.cond_words());
+	return bounds_overlap(cond.lower.data(), cond.upper.data(), pop.lower(cl), pop.upper(cl), pop.cond_len());
+}
+
+/// Returns true if cond matches every input the condition of classifier cl matches
+bool
+condition_subsumes(const Population& pop, const Condition& cond, size_t cl) {
+	if (pop.binary())
+		return bits_subsume(cond.care.data(), cond.value.data(), pop.care(cl), pop.value(cl), pop.cond_words());
+	return bounds_subsume(cond.lower.data(), cond.upper.data(), pop.lower(cl), pop.upper(cl), pop.cond_len());
+}
+
+/// Returns the interleaved elements of a condition
+vector<double>
+condition_elements(const Population& pop, const Condition& cond) {
+	const size_t len = pop.cond_len();
+	vector<double> elements(2 * len);
+	for (size_t k = 0; k < len; k++) {
+		if (pop.binary()) {
+			const uint64_t bit = (uint64_t) 1 << (k % 64);
+			const double v = (cond.value[k / 64] & bit) ? 1.0 : 0.0;
+			const bool cares = cond.care[k / 64] & bit;
+			elements[2*k] = cares ? v : 0.0;
+			elements[2*k+1] = cares ? v : 1.0;
+		} else {
+			elements[2*k] = cond.lower[k];
+			elements[2*k+1] = cond.upper[k];
+		}
+	}
+	return elements;
+}
+
 string
 act_str(const Rule& rule) {
 	return std::to_string(rule.act);
@@ -122,7 +250,7 @@ operator<<(std::ostream& out, const Classifier& cl) {
 	const char sep = ';';
 
 	// Format rule
-	out << cl.cond << sep;
+	out << compose_cond(cl.rule.elements) << sep;
 	out << act_str(cl.rule) << sep;
 
 	// Print parameters
@@ -135,135 +263,154 @@ operator<<(std::ostream& out, const Classifier& cl) {
 	return out;
 }
 
-vector<double>
-transform_input(std::string origInput) {
+Input
+transform_input(const std::string& origInput) {
 	size_t inputLen = origInput.size();
-	vector<double> input;
+	Input input;
 
 	int inputMode = 0;
 	for (size_t i=0; i<origInput.size(); i++)
 		if (origInput[i] != '0' && origInput[i] != '1') inputMode = 1;
 
 	if (inputMode == 0) {
-		input.resize(inputLen);
-		for (size_t i=0; i<inputLen; i++) input[i] = 1.0 * (origInput[i] - 48);
+		input.binary = true;
+		input.len = inputLen;
+		input.bits.resize((inputLen + 63) / 64, 0);
+		for (size_t i=0; i<inputLen; i++)
+			if (origInput[i] == '1') input.bits[i / 64] |= (uint64_t) 1 << (i % 64);
 	} else {
 	    char_separator<char> sep(";");
 	    tokenizer<char_separator<char>> tokens(origInput, sep);
-	    for (const string& t : tokens) input.push_back(stod(t));
+	    for (const string& t : tokens) input.values.push_back(stod(t));
+	    input.len = input.values.size();
 	}
 
 	return input;
 }
 
+namespace {
+
+template <typename T>
+void
+load_real_input(Input& input, const T* values, size_t len) {
+	input.binary = false;
+	input.len = len;
+	input.values.assign(values, values + len);
+	input.bits.clear();
+}
+
+} // namespace
+
+void
+load_input(Input& input, const double* values, size_t len) {
+	load_real_input(input, values, len);
+}
+
+void
+load_input(Input& input, const float* values, size_t len) {
+	load_real_input(input, values, len);
+}
+
+void
+load_input(Input& input, const uint64_t* bits, size_t len) {
+	const size_t words = (len + 63) / 64;
+	input.binary = true;
+	input.len = len;
+	input.values.clear();
+	input.bits.assign(bits, bits + words);
+	// positions past len must not take part in matching
+	if (len % 64)
+		input.bits[words - 1] &= ((uint64_t) 1 << (len % 64)) - 1;
+}
+
 /// Generates a match set using the population and problem input
-std::pair<ClassifierSet, bool>
-generate_match_set(ClassifierSet& pop, const ActionSpace& as, std::string origInput, const size_t& max_pop_size) {
-	ClassifierSet match_set;
+bool
+generate_match_set(Population& pop, const ActionSpace& as, const Input& input,
+                   const size_t& max_pop_size, ClassifierSet& match_set, Rng& rng) {
 	bool modified = false;
+	match_set.clear();
 
-	vector<double> input = transform_input(origInput);
+	if (pop.empty())
+		pop.set_binary(input.binary);
 
 	while (match_set.empty()) {
-		for (auto it = pop.begin(); it != pop.end(); it++) {
-			if (elements_match((*it)->rule.elements, input)) {
-				match_set.push_back(*it);
+		if (!pop.binary() && !input.binary && pop.cond_len() == input.len) {
+			match_bounds(pop.lower(0), pop.upper(0), pop.size(), input.len, input.values.data(), match_set);
+		} else if (pop.match_index() && input.binary && pop.cond_len() == input.len) {
+			pop.match_index()->match(input.bits.data(), match_set);
+		} else {
+			for (size_t c = 0; c < pop.size(); c++) {
+				if (classifier_matches(pop, c, input)) {
+					match_set.push_back(c);
+				}
 			}
 		}
 
 		size_t pop_num = set_numerosity(pop);
-		const size_t num_diff_actions = num_different_actions(match_set);
+		// deleting below invalidates the indices in match_set
+		const ActionMask present = present_actions(pop, match_set);
+		const size_t num_diff_actions = present.count();
 		const size_t num_of_actions = as.size();
 		const int space = as.size() - num_diff_actions;
 		if (space > 0) {
 			if (pop_num + space > max_pop_size)
 				do {
-					bool deleting = false;
-					for (size_t i=0; i<pop.size(); i++)
-						if (pop[i]->experience == 0) {
-							delete_classifier(pop, pop[i]);
-							deleting = true;
-						}
-					if (!deleting) delete_from_population(pop, input);
+					const bool deleting = pop.erase_inexperienced() > 0;
+					if (!deleting) delete_from_population(pop, input, rng);
 					modified |=  deleting;
 					pop_num = set_numerosity(pop);
 				} while (pop_num + num_of_actions - num_diff_actions > max_pop_size);
-			pop.push_back(std::make_shared<Classifier>(generate_covering_classifier(match_set, as, input)));
+			insert_covering_classifier(pop, present, as, input, rng);
 			match_set.clear(); // try again with added classifier
 		}
 	}
-	return std::make_pair(match_set, modified);
+	return modified;
 }
 
-/// Calculates the total numerosity of a ClassifierSet
+/// Returns the total numerosity of a Population
 unsigned int
-set_numerosity(const ClassifierSet &set) {
-	unsigned int total_num = 0;
-	for (const auto& c : set) {
-		total_num += c->numerosity;
-	}
-	return total_num;
+set_numerosity(const Population& pop) {
+	return pop.total_numerosity();
 }
 
-/// Calculates the total fitness of a ClassifierSet
+/// Returns the total fitness of a Population
 double
-set_fitness(const ClassifierSet &set) {
-	double total_fitness = 0;
-	for (const auto& c : set) {
-		total_fitness += c->fitness;
-	}
-	return total_fitness;
+set_fitness(const Population& pop) {
+	return pop.total_fitness();
 }
 
 /// Returns true if it has removed/deleted a classifier from the population
 bool
-delete_from_population(ClassifierSet& pop, const vector<double>& input) {
-	unsigned int pop_numerosity = set_numerosity(pop);
-
-	//	return false;
-
-	const double pop_fitness = set_fitness(pop);
-	const double mean_fitness = pop_fitness / pop_numerosity;
-
-	double vote_sum = 0;
-	for (const auto& c : pop) {
-		vote_sum += (double) get_del_prop(*c, mean_fitness);
-	}
-
+delete_from_population(Population& pop, const Input& input, Rng& rng) {
 	// Roulete like deletion
-	const double choice_point = random_number(0, vote_sum);
-	vote_sum = 0;
-	int pop_size = pop.size();
-	for (int i=0; i<pop_size; i++) {
-		ClassifierPtr c = pop[i];
-		vote_sum += get_del_prop(*c, mean_fitness);
-
-		if (vote_sum > choice_point) {
-			if (elements_match(c->rule.elements, input)) {
-				do {
-					i++;
-					if (i == pop_size) i=0;
-					c = pop[i];
-				} while (elements_match(c->rule.elements, input));
-			}
+	DeletionWheel& wheel = pop.deletion_wheel();
+	const double choice_point = rng.uniform(0, wheel.vote_sum());
+	size_t i = wheel.find(choice_point);
+	if (i == pop.size())
+		return false;
 
-			c->numerosity--;
-			//std::cout << c->cond << ":" << c->rule.act << "->" << c->prediction << "; Num: " << c->numerosity << "; Exp: " << c->experience << "; Fit: " << c->fitness << " is REMOVED." << std::endl;
-			if (c->numerosity == 0) delete_classifier(pop, c);
-			return true;
-		}
-	} // for
+	if (classifier_matches(pop, i, input)) {
+		do {
+			i++;
+			if (i == pop.size()) i=0;
+		} while (classifier_matches(pop, i, input));
+	}
 
-	return false;
+	pop.set_numerosity(i, pop.numerosity(i) - 1);
+	//std::cout << pop.get(i) << " is REMOVED." << std::endl;
+	if (pop.numerosity(i) == 0) delete_classifier(pop, i);
+	return true;
 }
 
 double
-get_del_prop(const Classifier& cl, const double mean_fitness) {
-	assert(cl.numerosity != 0);
-	double vote = cl.actionset_size * cl.numerosity;
-	if (cl.fitness / cl.numerosity >= DELTA_DELETION * mean_fitness ||
-			cl.experience < THETA_DEL) {
-		vote = vote * mean_fitness / (cl.fitness / cl.numerosity);
+get_del_prop(const Population& pop, size_t i, const double mean_fitness) {
+	const unsigned int numerosity = pop.numerosity(i);
+	const double fitness = pop.fitness(i);
+	assert(numerosity != 0);
+	double vote = pop.actionset_size(i) * numerosity;
+	if (fitness / numerosity >= DELTA_DELETION * mean_fitness ||
+			pop.experience(i) < THETA_DEL) {
+		vote = vote * mean_fitness / (fitness / numerosity);
 	}
 //	std::cout << "Vote: " << cl.fitness << " ... " << cl.numerosity << " ... " << vote << std::endl;
 	return vote;
@@ -276,62 +423,15 @@ actions_diff(const set<Action>& lhs, const set<Action>& rhs) {
 	return diff;
 }
 
-Classifier
-generate_classifier(const vector<double>& input) {
-	Classifier cl_new;
-	size_t len = input.size();
-	cl_new.rule.elements.resize(2*len);
-
-	// check binary
-	bool isBinary = true;
-	for (size_t i=0; i<len; i++)
-		if (input[i] != 0.0 && input[i] != 1.0) isBinary = false;
-
-	std::string covered = "";
-	for (size_t i=0; i<len; i++) {
-		cl_new.rule.elements[2*i] = input[i];
-		cl_new.rule.elements[2*i+1] = input[i];
-		std::string the_input = std::to_string(input[i]);
-		std::string element = "";
-		if (isBinary) {
-			the_input.resize(1);
-			element = the_input;
-		} else
-		{
-			the_input.resize(5);
-			element = "["+the_input+"]";
-		}
-		covered += element;
-	}
-	cl_new.cond = covered;
-
-	cl_new.rule.act = 0;
-
-	// Random action not present in [M]
-	cl_new.prediction = PREDICTION_INIT;
-	cl_new.prediction_error = PREDICTION_ERROR_INIT;
-	cl_new.fitness = FITNESS_INIT;
-
-	cl_new.experience = 0;
-	cl_new.numerosity = 1;
-	//cl_new.timestamp = std::chrono::system_clock::now();
-	cl_new.actionset_size = 1;
-	cl_new.disproving = 0;
-
-	return cl_new;
-}
-
-Classifier
-generate_covering_classifier(ClassifierSet& match_set, const ActionSpace& as, const vector<double>& input) {
-	Classifier cl_new = generate_classifier(input);
-
+size_t
+insert_covering_classifier(Population& pop, const ActionMask& present, const ActionSpace& as,
+                           const Input& input, Rng& rng) {
 	// calculates all remaining actions = actions - already present actions
-	auto present_a = present_actions(classifer_set_rules(match_set));
-	auto remaining_actions = actions_diff(as, present_a);
-
-	cl_new.rule.act = random_action(remaining_actions).value_or(*all_actions().cbegin());
+	ActionMask remaining_actions;
+	for (Action act : as)
+		remaining_actions[act] = !present[act];
 
-	return cl_new;
+	return pop.push_back(input, random_action(remaining_actions, rng).value_or(*all_actions().cbegin()));
 }
 
 set<Action>
@@ -346,23 +446,36 @@ present_actions(const RuleSet& rules) {
 	return actions;
 }
 
+ActionMask
+present_actions(const Population& pop, const ClassifierSet& classifiers) {
+	ActionMask actions;
+
+	for (size_t c : classifiers)
+		actions.set(pop.act(c));
+
+	return actions;
+}
+
 optional<Action>
-random_action(const set<Action>& actions) {
+random_action(const set<Action>& actions, Rng& rng) {
 	if (actions.size() < 1)
 		return nullopt;
-	auto randi = random_uint(0, actions.size() - 1);
+	auto randi = rng.uniform_uint(0, actions.size() - 1);
 	set<Action>::const_iterator it(actions.begin());
 	std::advance(it, randi);
 	return optional<Action>(*it);
 }
 
-// TODO: Probably remove
-RuleSet
-classifer_set_rules(const ClassifierSet& classifiers) {
-	RuleSet rules;
-	for (const auto& c : classifiers)
-		rules.push_back(c->rule);
-	return rules;
+optional<Action>
+random_action(const ActionMask& actions, Rng& rng) {
+	if (actions.none())
+		return nullopt;
+	auto randi = rng.uniform_uint(0, actions.count() - 1);
+	size_t act = 0;
+	for (;; act++)
+		if (actions[act] && randi-- == 0)
+			break;
+	return optional<Action>(act);
 }
 
 unsigned int
@@ -371,155 +484,124 @@ num_different_actions(const RuleSet& rules) {
 }
 
 unsigned int
-num_different_actions(const ClassifierSet& classifiers) {
-	const auto rules = classifer_set_rules(classifiers);
-	return num_different_actions(rules);
+num_different_actions(const Population& pop, const ClassifierSet& classifiers) {
+	return present_actions(pop, classifiers).count();
 }
 
-set<Action>
+const set<Action>&
 all_actions() {
-	return set<Action> {0, 1};
+	static const set<Action> actions {0, 1};
+	return actions;
 }
 
-PredictionArray
-generate_prediction_array(const ClassifierSet& match_set) {
-	PredictionArray pa;
-	PredictionArray fsa;
-	for (const auto& cl : match_set) {
-		const auto& act = cl->rule.act;
-		if (pa.find(act) == pa.end()) {
-			pa[act] = cl->prediction * cl->fitness;
+void
+generate_prediction_array(const Population& pop, const ClassifierSet& match_set, PredictionArray& pa) {
+	pa.clear();
+	for (size_t cl : match_set) {
+		const auto act = pop.act(cl);
+		// a match set holds few actions, a scan finds them fastest
+		auto entry = pa.begin();
+		while (entry != pa.end() && entry->act != act)
+			entry++;
+		if (entry == pa.end()) {
+			pa.push_back(ActionPrediction{act, pop.prediction(cl) * pop.fitness(cl), 0.0});
+			entry = pa.end() - 1;
 		} else {
-			pa[act] = pa[act] + cl->prediction * cl->fitness;
+			entry->prediction = entry->prediction + pop.prediction(cl) * pop.fitness(cl);
 		}
-		fsa[act] = fsa[act] + cl->fitness;
+		entry->fitness = entry->fitness + pop.fitness(cl);
 	}
 
-	for (const auto& act : all_actions()) {
-		if (fsa.find(act) != fsa.end() && fsa[act] != 0) {
-			pa[act] = pa[act] / fsa[act];
+	for (ActionPrediction& entry : pa) {
+		if (entry.fitness != 0) {
+			entry.prediction = entry.prediction / entry.fitness;
 		}
 	}
-	return pa;
 }
 
-using pair_type = PredictionArray::value_type;
 int
-select_action(const PredictionArray& pa, ActionMode mode) {
+select_action(const PredictionArray& pa, ActionMode mode, Rng& rng) {
 	if (mode == ActionMode::Explore || pa.size() < 1) {
 		// Explore using a random action not present in pa
-		auto ra = all_actions();
-		for (const auto& kv : pa) {
-			ra.erase(kv.first);
+		ActionMask ra;
+		for (Action act : all_actions())
+			ra.set(act);
+		for (const ActionPrediction& entry : pa) {
+			ra.reset(entry.act);
 		}
-		return random_action(ra).value_or(random_action(all_actions()).value());
+		return random_action(ra, rng).value_or(random_action(all_actions(), rng).value());
 	} else {
 		// Pure exploitation using the best action in pa
 		assert(pa.size() > 0);
-		auto best_action = std::max_element(std::begin(pa), std::end(pa), [](const pair_type& p1, const pair_type& p2) {
-			return p1.second < p2.second;
+		auto best_action = std::max_element(pa.rbegin(), pa.rend(), [](const ActionPrediction& p1, const ActionPrediction& p2) {
+			return p1.prediction < p2.prediction;
 		});
-		return best_action->first;
+		return best_action->act;
 	}
 }
 
-ClassifierSet
-generate_action_set(const ClassifierSet& match_set, const Action act) {
-	ClassifierSet action_set;
-	for (const auto& cl : match_set) {
-		if (cl->rule.act == act)
+void
+generate_action_set(const Population& pop, const ClassifierSet& match_set, const Action act,
+                    ClassifierSet& action_set) {
+	action_set.clear();
+	for (size_t cl : match_set) {
+		if (pop.act(cl) == act)
 			action_set.push_back(cl);
 	}
-	return action_set;
 }
 
 void
-update_fitness(ClassifierSet& action_set) {
-	double accuracy_sum = 0;
-	const auto ass = action_set.size();
-
-	vector<double> k;
-	k.resize(ass, 0.0);
-	for (size_t i = 0; i < ass; i++) {
-		const auto& cl = action_set.at(i);
-		if (cl->prediction_error < EPSILON_ZERO)
-			k[i] = 1;
-		else
-			k[i] = ALPHA * pow((cl->prediction_error / EPSILON_ZERO), -POWER_PARAMETER);
-		accuracy_sum += k[i] * cl->numerosity;
-	}
-	for (size_t i = 0; i < ass; i++) {
-		auto& cl = action_set.at(i);
-		cl->fitness += BETA * ((k[i] * cl->numerosity) / accuracy_sum - cl->fitness);
-	}
+update_fitness(Population& pop, const ClassifierSet& action_set, ActionSetView& view) {
+	view.gather(pop, action_set);
+	update_fitness(view, update_accuracy(view));
+	view.scatter(pop, action_set);
 }
 
 /// Returns true if the population was modified
 bool
-update_set(std::string origInput, const Action act, double reward, ClassifierSet& action_set, ClassifierSet& pop) {
+update_set(const Input& input, const Action act, double reward, ClassifierSet& action_set, Population& pop,
+           ActionSetView& view) {
 	bool modified = false;
 	unsigned int total_numerosity = 0;
-	for (const auto& cl : action_set) {
-		total_numerosity += cl->numerosity;
+	for (size_t cl : action_set) {
+		total_numerosity += pop.numerosity(cl);
 	}
 
-	for (auto& cl : action_set) {
-		cl->experience++;
-		if (cl->experience == MIN_EXP)
-			modified = true;
-
-		// Update prediction
-		if (cl->experience < 1 / BETA)
-			cl->prediction = cl->prediction + (reward - cl->prediction) / cl->experience;
-		else
-			cl->prediction = cl->prediction + BETA * (reward - cl->prediction);
-
-		// Update action set size estimate
-		if (cl->experience < 1 / BETA)
-			cl->actionset_size = cl->actionset_size + (total_numerosity - cl->actionset_size) / cl->experience;
-		else
-			cl->actionset_size = cl->actionset_size + (total_numerosity - cl->actionset_size);
-
-		double oldPredErr = cl->prediction_error;
-		// Update prediction_error
-		if (cl->experience < 1 / BETA) {
-			assert(cl->experience != 0);
-			cl->prediction_error =
-			    cl->prediction_error + (std::abs(reward - cl->prediction) - cl->prediction_error) / cl->experience;
-		} else
-			cl->prediction_error =
-			    cl->prediction_error + BETA * (std::abs(reward - cl->prediction) - cl->prediction_error);
-
-		if (cl->experience >= 2*MIN_EXP && oldPredErr <= PRED_ERR_TOL && cl->prediction_error > PRED_ERR_TOL) {
-			// std::cout << "cl*: " << cl->cond << ":" << cl-> rule.act << "->" <<
-			// cl->prediction << " is REMOVED " << std::endl;
-			delete_classifier(pop, cl);
+	view.gather(pop, action_set);
+	const double accuracy_sum = update_action_set(view, reward, total_numerosity);
+	update_fitness(view, accuracy_sum);
+	view.scatter(pop, action_set);
 
+	for (size_t k = 0; k < view.size(); k++) {
+		if (view.experience[k] == MIN_EXP)
+			modified = true;
+		if (view.erroneous[k]) {
 			// insert new classifier to population based on the current state
-			ClassifierPtr cl_new = std::make_shared<Classifier>(generate_classifier(transform_input(origInput)));
-			cl_new->rule.act = act;
-			cl_new->prediction = reward;
-			cl_new->experience = 1;
-			cl_new->prediction_error = std::abs(reward - PREDICTION_INIT);
-			pop.push_back(cl_new);
+			const size_t cl_new = pop.push_back(input, act);
+			pop.set_prediction(cl_new, reward);
+			pop.set_experience(cl_new, 1);
+			pop.prediction_error(cl_new) = std::abs(reward - PREDICTION_INIT);
 
 			modified = true;
 		}
 	}
-	update_fitness(action_set);
+
+	// action_set is sorted by index, so deleting from the back keeps the rest valid
+	for (size_t k = view.size(); k-- > 0;)
+		if (view.erroneous[k])
+			delete_classifier(pop, action_set[k]);
 	return modified;
 }
 
-void
-insert_into_population(ClassifierSet& pop, const ClassifierPtr& cl) {
-	assert(cl->rule.elements.size() > 0);
-	for (auto& pcl : pop) {
-		if (pcl->rule == cl->rule) {
-			pcl->numerosity++;
-			return;
-		}
+size_t
+insert_into_population(Population& pop, const Classifier& cl) {
+	assert(cl.rule.elements.size() > 0);
+	const size_t pcl = pop.find_rule(cl.rule);
+	if (pcl < pop.size()) {
+		pop.set_numerosity(pcl, pop.numerosity(pcl) + 1);
+		return pcl;
 	}
-	pop.push_back(cl);
+	return pop.push_back(cl);
 }
 
 bool
@@ -540,210 +622,496 @@ is_more_general(const Classifier& cl_gen, const Classifier& cl_spc) {
 }
 
 bool
-is_subsumable(ClassifierPtr cl, ClassifierPtr subsumer) {
-	vector<double> cl1 = subsumer->rule.elements;
-	vector<double> cl2 = cl->rule.elements;
+is_subsumable(const Population& pop, size_t cl, size_t subsumer) {
+	if (pop.act(subsumer) != pop.act(cl)) return false;
 
-	if (subsumer->rule.act != cl->rule.act) return false;
-	if (cl1.size() != cl2.size()) return false;
-
-	const size_t len = cl1.size() / 2;
-	for (size_t i=0; i<len; i++)
-		if (cl1[2*i] > cl2[2*i] || cl1[2*i+1] < cl2[2*i+1]) return false;
+	if (pop.binary())
+		return bits_subsume(pop.care(subsumer), pop.value(subsumer), pop.care(cl), pop.value(cl), pop.cond_words());
+	return bounds_subsume(pop.lower(subsumer), pop.upper(subsumer), pop.lower(cl), pop.upper(cl), pop.cond_len());
+}
 
+bool
+delete_classifier(Population& pop, size_t i) {
+	if (i >= pop.size())
+		return false;
+	pop.swap_erase(i);
 	return true;
 }
 
-bool
-delete_classifier(ClassifierSet& clset, ClassifierPtr cl) {
-	for (auto it = clset.begin(); it != clset.end();) {
-		if (**it == *cl) {
-			clset.erase(it);
-			return true;
-		} else {
-			it++;
-		}
+size_t
+index_after_deleting(size_t cl, const ClassifierSet& victims, size_t size) {
+	assert(std::is_sorted(victims.begin(), victims.end()));
+	// the classifier last in the population is never a victim still to go
+	for (auto it = victims.rbegin(); it != victims.rend(); it++) {
+		size--;
+		if (cl == *it)
+			return SIZE_MAX;
+		if (cl == size)
+			cl = *it;
 	}
-	return false;
+	return cl;
 }
 
-int
-count_cl_action(ClassifierSet& clSet, size_t act) {
-	int num = 0;
-	for (auto& cl : clSet)
-		if (cl->rule.act == act) num++;
-	return num;
+/// Deletes the classifiers at the given sorted indices from the population
+/// and keeps the indices in clSet pointing at the same classifiers, marking
+/// the victims among them with SIZE_MAX
+void
+erase_classifiers(Population& pop, const ClassifierSet& victims, ClassifierSet& clSet) {
+	for (size_t& cl : clSet)
+		cl = index_after_deleting(cl, victims, pop.size());
+	for (auto it = victims.rbegin(); it != victims.rend(); it++)
+		delete_classifier(pop, *it);
 }
 
 /// Returns true if it has modified the population
 bool
-remove_outlier(ClassifierSet& pop) {
+remove_outlier(Population& pop) {
 	bool modified = false;
-	vector<ClassifierPtr> clSet;
+	const double max_disproval_rate = pow(10, MAX_DISP_RATE);
 
-	for (ClassifierPtr& cl : pop)
-		clSet.push_back(cl);
-
-	for (size_t i=0; i<clSet.size(); i++) {
-		if (clSet[i]->experience > 0 && clSet[i]->disproving / clSet[i]->experience > pow(10, MAX_DISP_RATE)) {
+	for (size_t i=pop.size(); i-- > 0;) {
+		if (pop.experience(i) > 0 && pop.disproving(i) / pop.experience(i) > max_disproval_rate) {
 				/*
-				std::cout << "DEL: " << clSet[i]->cond << ":" << clSet[i]->rule.act << "->" << clSet[i]->prediction << std::endl;
+				std::cout << "DEL: " << pop.get(i) << std::endl;
 				//*/
-				delete_classifier(pop, clSet[i]);
+				delete_classifier(pop, i);
 				modified = true;
 		}
 	}
 	return modified;
 }
 
+void
+sort_population(Population& pop) {
+	// The action and the top 56 bits of the prediction are packed into one
+	// key that a radix sort orders. Classifiers with equal keys, mostly those
+	// of equal predictions, are then ordered by the whole prediction, the
+	// condition key and the id. Different conditions can share a condition
+	// key, the id makes the order independent of the order before.
+	struct SortKey {
+		uint64_t key;
+		size_t index;
+	};
+	const size_t n = pop.size();
+	vector<uint64_t> predictions(n);
+	vector<SortKey> keys(n);
+	for (size_t i = 0; i < n; i++) {
+		// flipping the sign bit of a non-negative prediction and every bit
+		// of a negative one orders the bits like the predictions, the
+		// complement of that orders them descending. -0.0 becomes 0.0.
+		const double prediction = pop.prediction(i) + 0.0;
+		uint64_t bits;
+		std::memcpy(&bits, &prediction, sizeof bits);
+		predictions[i] = ~((bits >> 63) ? ~bits : bits | ((uint64_t) 1 << 63));
+		keys[i] = SortKey{(uint64_t) pop.act(i) << 56 | predictions[i] >> 8, i};
+	}
+	auto less = [&](size_t lhs, size_t rhs) {
+		if (pop.act(lhs) != pop.act(rhs))
+			return pop.act(lhs) < pop.act(rhs);
+		if (predictions[lhs] != predictions[rhs])
+			return predictions[lhs] < predictions[rhs];
+		if (pop.cond_key(lhs) != pop.cond_key(rhs))
+			return pop.cond_key(lhs) < pop.cond_key(rhs);
+		return pop.id(lhs) < pop.id(rhs);
+	};
+
+	// a population sorted before and left alone since keeps its columns
+	bool sorted = true;
+	for (size_t i = 1; i < n && sorted; i++)
+		sorted = less(i - 1, i);
+	if (sorted)
+		return;
+
+	// least significant byte first, skipping the bytes every key shares
+	size_t count[8][256] = {};
+	for (const SortKey& k : keys)
+		for (size_t d = 0; d < 8; d++)
+			count[d][(k.key >> (8 * d)) & 0xff]++;
+	vector<SortKey> spare(n);
+	for (size_t d = 0; d < 8; d++) {
+		if (count[d][(keys[0].key >> (8 * d)) & 0xff] == n)
+			continue;
+		size_t sum = 0;
+		for (size_t& c : count[d]) {
+			const size_t keys_below = sum;
+			sum += c;
+			c = keys_below;
+		}
+		for (const SortKey& k : keys)
+			spare[count[d][(k.key >> (8 * d)) & 0xff]++] = k;
+		keys.swap(spare);
+	}
+	for (size_t begin = 0, end = 0; begin < n; begin = end) {
+		for (end = begin + 1; end < n && keys[end].key == keys[begin].key; end++)
+			;
+		std::sort(keys.begin() + begin, keys.begin() + end,
+		          [&](const SortKey& lhs, const SortKey& rhs) { return less(lhs.index, rhs.index); });
+	}
+
+	vector<size_t> order(n);
+	for (size_t k = 0; k < n; k++)
+		order[k] = keys[k].index;
+	pop.permute(order);
+}
+
+/// Sets ids to the id and index of every classifier of pop, sorted by id
+void
+index_ids(const Population& pop, vector<std::pair<uint64_t, size_t>>& ids) {
+	ids.clear();
+	for (size_t cl = 0; cl < pop.size(); cl++)
+		ids.push_back(std::make_pair(pop.id(cl), cl));
+	std::sort(ids.begin(), ids.end());
+}
+
+/// Returns the index of the classifier with the given id, or SIZE_MAX if
+/// combining has erased it
+size_t
+index_of_id(const vector<std::pair<uint64_t, size_t>>& ids, uint64_t id) {
+	const auto it = std::lower_bound(ids.begin(), ids.end(), std::make_pair(id, (size_t) 0));
+	return (it != ids.end() && it->first == id) ? it->second : SIZE_MAX;
+}
+
+/// Examines the candidate pair (cl_i, cl_j) unless it is known to be
+/// disproved, and merges it if nothing disproves it. A merge erases both
+/// candidates and the ones the merged classifier subsumes, and queues what
+/// it has changed in the cursor.
+///
+/// Returns true if it has merged the pair
 bool
-combine_set(const ActionSpace& as, ClassifierSet& pop) {
-	bool modified = false;
-	vector<ClassifierPtr> clCombSet;
-	int not_combined = 0;
-	size_t combSetSize = 0;
+combine_pair(Population& pop, CombineCursor& cursor, DisprovalCache* cache, size_t cl_i, size_t cl_j,
+             size_t& budget) {
+	// scratch storage, so that rejecting a candidate does not allocate
+	Condition& star_cond = cursor.star_cond;
+	// classifiers examined for a candidate, found through overlaps for real valued populations
+	ClassifierSet& examined = cursor.examined;
+	ClassifierSet& disprovers = cursor.disprovers;
+	ClassifierSet& deletions = cursor.deletions;
+	OverlapIndex& overlaps = cursor.overlaps;
+	ClassifierSet& clCombSet = cursor.candidates;
+	size_t& sorted = cursor.sorted;
+	RejectedPairs& rejected = cursor.rejected;
+	ClassifierSet& added = cursor.added;
+	vector<uint64_t>& gone = cursor.gone;
+
+	double cl_star_pred = 0.0;
+
+	combine_conditions(pop, cl_i, cl_j, star_cond);
+	cl_star_pred = (pop.prediction(cl_i) * pop.numerosity(cl_i) +
+	                pop.prediction(cl_j) * pop.numerosity(cl_j)) /
+	               (pop.numerosity(cl_i) + pop.numerosity(cl_j));
+
+	RejectedPairs::Entry* known = rejected.find(pop.id(cl_i), pop.id(cl_j));
+	if (known && !std::binary_search(gone.begin(), gone.end(), pop.id(cl_i)) &&
+	    !std::binary_search(gone.begin(), gone.end(), pop.id(cl_j)) &&
+	    !std::binary_search(gone.begin(), gone.end(), known->witness)) {
+		// still disproved, only the classifiers added since are left to flag
+		for (; known->added < added.size(); known->added++) {
+			const size_t cl_k = added[known->added];
+			if (MAX_DISP_RATE > 0 && cl_k < pop.size() && cl_k != cl_i && cl_k != cl_j &&
+			    !pop.disproves(cl_k) && pop.experience(cl_k) > 0 &&
+			    condition_overlaps(pop, star_cond, cl_k) &&
+			    !within_range(cl_star_pred, pop.prediction(cl_k), PRED_TOL))
+				pop.set_disproves(cl_k, true);
+		}
+		return false;
+	}
 
-	std::sort(pop.begin(), pop.end(), [](const ClassifierPtr& l, const ClassifierPtr& r) { return *l < *r; });
+	// examination
+	budget--;
+	examined.clear();
+	disprovers.clear();
+	// the overlap index only returns classifiers overlapping the star
+	bool overlapping = false;
+	if (cache && cache->lookup(pop, cl_i, cl_j, disprovers, examined)) {
+		// only the classifiers changed since the last examination can differ
+	} else if (pop.binary()) {
+		examined = clCombSet;
+	} else {
+		overlaps.query(star_cond.lower.data(), star_cond.upper.data(), examined);
+		overlapping = true;
+	}
+	for (size_t cl_k : examined) {
+		if (cl_k!=cl_i && cl_k!=cl_j && pop.experience(cl_k) > 0)
+			if ((overlapping || condition_overlaps(pop, star_cond, cl_k)) &&
+				!within_range(cl_star_pred, pop.prediction(cl_k), PRED_TOL)) {
+				/*
+				std::cout << "DISPROVED by " << pop.get(cl_k) << std::endl;
+				//*/
+				disprovers.push_back(cl_k);
+				// unless disproving is counted or cached, the first disprover is enough
+				if (MAX_DISP_RATE == 0 && !cache)
+					break;
+			}
+	}
+	if (!disprovers.empty()) {
+		if (MAX_DISP_RATE > 0)
+			for (size_t cl_k : disprovers)
+				pop.set_disproves(cl_k, true);
+		if (cache)
+			cache->store(pop, cl_i, cl_j, disprovers);
+		rejected.insert(pop.id(cl_i), pop.id(cl_j), pop.id(disprovers.front()), added.size());
+		return false;
+	}
+	/*
+	std::cout << "APPROVED!!!" << std::endl;
+	//*/
+
+	// add parents' attribute
+	Classifier cl_star;
+	cl_star.rule.elements = condition_elements(pop, star_cond);
+	cl_star.rule.act = pop.act(cl_i);
+	cl_star.experience = pop.experience(cl_i) + pop.experience(cl_j);
+	cl_star.numerosity = pop.numerosity(cl_i) + pop.numerosity(cl_j);
+	cl_star.prediction = cl_star_pred * cl_star.numerosity;
+
+	// the sweep goes on with the row after the ones erased
+	const bool sweeping = cursor.i < sorted;
+	deletions.assign({cl_i, cl_j});
+	for (size_t d=clCombSet.size(); d-- > 0;) {
+		const size_t cl = clCombSet[d];
+		bool erased = cl == cl_i || cl == cl_j;
+		if (!erased && condition_subsumes(pop, star_cond, cl) &&
+		    (within_range(cl_star_pred, pop.prediction(cl), PRED_TOL) || pop.experience(cl) == 0)) {
+
+			if (pop.experience(cl) > 0) {
+				// subsume
+				cl_star.experience += pop.experience(cl);
+				cl_star.numerosity += pop.numerosity(cl);
+				cl_star.prediction += pop.prediction(cl) * pop.numerosity(cl);
+			}
+			//std::cout << pop.get(cl) << " is DELETED." << std::endl;
+			deletions.push_back(cl);
+			erased = true;
+		}
+		if (erased) {
+			clCombSet.erase(clCombSet.begin() + d);
+			if (d < sorted)
+				sorted--;
+			if (sweeping && d < cursor.i)
+				cursor.i--;
+		}
+	}
+	cl_star.prediction = cl_star.prediction / cl_star.numerosity;
+	std::sort(deletions.begin(), deletions.end());
+
+	// erased witnesses leave their pairs to be examined again
+	const size_t size = pop.size();
+	for (size_t cl : deletions) {
+		gone.push_back(pop.id(cl));
+		rejected.witnessed(pop.id(cl), cursor.retry);
+		if (cache)
+			cache->erase(pop.id(cl));
+		(*std::lower_bound(cursor.ids.begin(), cursor.ids.end(), std::make_pair(pop.id(cl), (size_t) 0))).second = SIZE_MAX;
+	}
+	for (size_t cl = size - deletions.size(); cl < size; cl++) {
+		const size_t moved = index_after_deleting(cl, deletions, size);
+		if (moved != SIZE_MAX)
+			(*std::lower_bound(cursor.ids.begin(), cursor.ids.end(), std::make_pair(pop.id(cl), (size_t) 0))).second = moved;
+	}
+	for (size_t& cl : added)
+		cl = index_after_deleting(cl, deletions, size);
+	if (!pop.binary())
+		overlaps.swap_erase(deletions, size);
+	erase_classifiers(pop, deletions, clCombSet);
+	if (cache)
+		for (size_t cl : deletions)
+			if (cl < pop.size())
+				cache->place(pop, cl);
+
+	const double exp_lim = 1 / BETA;
+	cl_star.prediction_error =
+	    (cl_star.experience <= floor(exp_lim))
+	        ? std::abs(cl_star.prediction - PREDICTION_INIT) / cl_star.experience
+	        : (std::abs(cl_star.prediction - PREDICTION_INIT) / exp_lim) *
+	              beta_decay(cl_star.experience - (unsigned int) floor(exp_lim));
+	cl_star.fitness = (FITNESS_INIT - 1) * beta_decay(cl_star.experience) + 1;
+	cl_star.disproving = 0;
+	//std::cout << "Comb Pred: " << cl_star.prediction << " Exp: " << cl_star.experience << "; Fitness: " << cl_star.fitness << std::endl;
+
+	// adds cl_star to combining set, a classifier with the same rule only
+	// gains numerosity, which changes its pairs
+	const size_t star = insert_into_population(pop, cl_star);
+	if (pop.size() > size - deletions.size()) {
+		clCombSet.push_back(star);
+		added.push_back(star);
+		assert(cursor.ids.empty() || cursor.ids.back().first < pop.id(star));
+		cursor.ids.push_back(std::make_pair(pop.id(star), star));
+		if (!pop.binary())
+			overlaps.insert(pop, star);
+	} else {
+		gone.push_back(pop.id(star));
+		rejected.witnessed(pop.id(star), cursor.retry);
+	}
+	cursor.rows.push_back(pop.id(star));
+	std::sort(gone.begin(), gone.end());
+	if (cache)
+		cache->place(pop, star);
+	return true;
+}
 
-	for (size_t action = 0; action < as.size() ; action++) {
+/// Combines the classifiers of a population holding a single action, sorted
+/// by descending prediction, starting or going on where the cursor stands.
+/// Merged classifiers are appended, the classifiers they replace are deleted
+/// in O(1) each. A cache, if given, spares examining pairs whose disprovers
+/// are known.
+///
+/// Returns false if it has stopped because budget candidate pairs were
+/// examined, with budget counted down
+bool
+combine_action(Population& pop, CombineCursor& cursor, DisprovalCache* cache, size_t& budget) {
+	// clCombSet[0, sorted) is ordered by descending prediction, merged
+	// classifiers are appended behind it
+	ClassifierSet& clCombSet = cursor.candidates;
+	size_t& sorted = cursor.sorted;
+	size_t& i = cursor.i;
+	size_t& j = cursor.j;
+
+	if (!cursor.started) {
+		cursor.started = true;
+		if (cache)
+			cache->begin(pop);
 
 		// recruiting
-		clCombSet.clear();
-		for (ClassifierPtr cl : pop) {
-			size_t cl_a = cl->rule.act;
-			if (cl_a == action) {
-				clCombSet.push_back(cl);
+		clCombSet.resize(pop.size());
+		std::iota(clCombSet.begin(), clCombSet.end(), 0);
+		cursor.examined.clear();
+		if (!pop.binary()) {
+			// only experienced classifiers can disprove a candidate
+			for (size_t cl : clCombSet)
+				if (pop.experience(cl) > 0)
+					cursor.examined.push_back(cl);
+			cursor.overlaps.assign(pop, cursor.examined);
+		}
+		index_ids(pop, cursor.ids);
+		sorted = clCombSet.size();
+		i = 0;
+		j = 1;
+		cursor.rows.clear();
+		cursor.next_row = 0;
+		cursor.in_row = false;
+		cursor.retry.clear();
+		cursor.next_retry = 0;
+		cursor.rejected.clear();
+		cursor.added.clear();
+		cursor.gone.clear();
+	}
+
+	// the sweep, the pairs of a row are in range up to the first that is not
+	for (; i<sorted; i++, j=i+1)
+		for (; j<sorted; j++) {
+
+			if (budget == 0)
+				return false;
+
+			const size_t cl_i = clCombSet[i];
+			const size_t cl_j = clCombSet[j];
+
+			if (pop.experience(cl_i) < MIN_EXP ||
+			    !within_range(pop.prediction(cl_i), pop.prediction(cl_j), PRED_TOL))
+				break;
+
+			// a merge erases the row, the next one takes its place
+			if (pop.experience(cl_j) >= MIN_EXP && combine_pair(pop, cursor, cache, cl_i, cl_j, budget))
+				j=i;
+		}
+
+	while (cursor.next_row < cursor.rows.size() || cursor.next_retry < cursor.retry.size()) {
+		if (cursor.next_row == cursor.rows.size()) {
+			if (budget == 0)
+				return false;
+			const RejectedPairs::Entry pair = cursor.retry[cursor.next_retry++];
+			const size_t cl_i = index_of_id(cursor.ids, pair.first);
+			const size_t cl_j = index_of_id(cursor.ids, pair.second);
+			if (cl_i != SIZE_MAX && cl_j != SIZE_MAX)
+				combine_pair(pop, cursor, cache, cl_i, cl_j, budget);
+			continue;
+		}
+
+		// a row pairs a merged or changed classifier with every candidate in range
+		const size_t cl_i = index_of_id(cursor.ids, cursor.rows[cursor.next_row]);
+		if (!cursor.in_row) {
+			if (cl_i == SIZE_MAX || pop.experience(cl_i) < MIN_EXP) {
+				cursor.next_row++;
+				continue;
 			}
+			const double prediction = pop.prediction(cl_i);
+			j = std::partition_point(clCombSet.begin(), clCombSet.begin() + sorted, [&](size_t cl) {
+				return pop.prediction(cl) > prediction + PRED_TOL;
+			}) - clCombSet.begin();
+			cursor.window = std::partition_point(clCombSet.begin() + j, clCombSet.begin() + sorted, [&](size_t cl) {
+				return pop.prediction(cl) + PRED_TOL >= prediction;
+			}) - clCombSet.begin();
+			cursor.in_row = true;
+		}
+		for (;; j++) {
+			if (j == cursor.window)
+				j = sorted;
+			if (j >= clCombSet.size())
+				break;
+			if (budget == 0)
+				return false;
+			const size_t cl_j = clCombSet[j];
+			if (cl_j != cl_i && pop.experience(cl_j) >= MIN_EXP &&
+			    within_range(pop.prediction(cl_i), pop.prediction(cl_j), PRED_TOL) &&
+			    combine_pair(pop, cursor, cache, cl_i, cl_j, budget))
+				break;
 		}
+		cursor.in_row = false;
+		cursor.next_row++;
+	}
 
-		not_combined = 0;
+	// classifiers merged after a pair was found disproved are flagged if they
+	// disprove it as well
+	if (MAX_DISP_RATE > 0)
+		for (const RejectedPairs::Entry& pair : cursor.rejected) {
+			// pairs of changed classifiers have been examined again by their rows
+			if (pair.first == 0 || std::binary_search(cursor.gone.begin(), cursor.gone.end(), pair.first) ||
+			    std::binary_search(cursor.gone.begin(), cursor.gone.end(), pair.second) ||
+			    std::binary_search(cursor.gone.begin(), cursor.gone.end(), pair.witness))
+				continue;
+			// still disproved, so this only flags
+			combine_pair(pop, cursor, cache, index_of_id(cursor.ids, pair.first),
+			             index_of_id(cursor.ids, pair.second), budget);
+		}
 
-		do {
-			combSetSize = clCombSet.size();
-			not_combined++;
-
-			for (size_t i=0; i<combSetSize; i++)
-				for (size_t j=i+1; j<combSetSize; j++) {
-
-					vector<double> el1 = clCombSet[i]->rule.elements;
-					vector<double> el2 = clCombSet[j]->rule.elements;
-
-					if (clCombSet[i]->experience >= MIN_EXP && clCombSet[j]->experience >= MIN_EXP &&
-					    within_range(clCombSet[i]->prediction, clCombSet[j]->prediction, PRED_TOL)) {
-
-						auto cl_star = std::make_shared<Classifier>(Classifier());
-						double cl_star_pred = 0.0;
-
-						size_t len = el1.size();
-						cl_star->rule.elements.resize(len);
-
-						for (size_t k=0; k<len/2; k++) {
-							cl_star->rule.elements[2*k]  = (el1[2*k]<el2[2*k])?el1[2*k]:el2[2*k];
-							cl_star->rule.elements[2*k+1]= (el1[2*k+1]>el2[2*k+1])?el1[2*k+1]:el2[2*k+1];
-						}
-						cl_star->rule.act = clCombSet[i]->rule.act;
-						cl_star_pred = (clCombSet[i]->prediction * clCombSet[i]->numerosity +
-						                clCombSet[j]->prediction * clCombSet[j]->numerosity) /
-						               (clCombSet[i]->numerosity + clCombSet[j]->numerosity);
-
-						/*
-						std::cout << "cl*: " << compose_cond(cl_star->rule.elements) << ":";
-						std::cout << cl_star-> rule.act << "->" << cl_star_pred << " ... ";
-						//*/
-
-						// examination
-						bool disproved = false;
-						for (size_t k=0; k<combSetSize; k++) {
-
-							if (k!=i && k!=j && clCombSet[k]->experience > 0)
-								if (elements_overlap(cl_star->rule.elements, clCombSet[k]->rule.elements) &&
-									!within_range(cl_star_pred, clCombSet[k]->prediction, PRED_TOL)) {
-									disproved = true;
-									/*
-									std::cout << "DISPROVED by " << compose_cond(clCombSet[k]->rule.elements) << ":";
-									std::cout << clCombSet[k]->rule.act << "->" << clCombSet[k]->prediction << std::endl;
-									//*/
-									if (MAX_DISP_RATE > 0) clCombSet[k]->disproves = true;
-										else k = combSetSize;
-								}
-						}
-						if (!disproved) {
-							/*
-							std::cout << "APPROVED!!!" << std::endl;
-							//*/
-
-							// add parents' attribute
-							cl_star->cond = compose_cond(cl_star->rule.elements);
-							cl_star->experience = clCombSet[i]->experience + clCombSet[j]->experience;
-							cl_star->numerosity = clCombSet[i]->numerosity + clCombSet[j]->numerosity;
-							cl_star->prediction = cl_star_pred * cl_star->numerosity;
-
-							delete_classifier(pop, clCombSet[j]);
-							delete_classifier(pop, clCombSet[i]);
-							//std::cout << "P2: " << compose_cond(clCombSet[j]->rule.elements) << ":" << clCombSet[j]->rule.act << "->" << clCombSet[j]->prediction << " is DELETED." << std::endl;
-							delete_classifier(clCombSet, clCombSet[j]);
-							//std::cout << "P1: " << compose_cond(clCombSet[i]->rule.elements) << ":" << clCombSet[i]->rule.act << "->" << clCombSet[i]->prediction << " is DELETED." << std::endl;
-							delete_classifier(clCombSet, clCombSet[i]);
-							combSetSize = clCombSet.size();
-
-							vector<int> deletions;
-							for (size_t d=0; d<combSetSize; d++) {
-								auto& cl = clCombSet[d];
-								bool in_range = within_range(cl_star_pred, cl->prediction, PRED_TOL);
-
-								if (is_subsumable(cl, cl_star) && (in_range || cl->experience == 0)) {
-
-									if (cl->experience > 0) {
-										// subsume
-										cl_star->experience += cl->experience;
-										cl_star->numerosity += cl->numerosity;
-										cl_star->prediction += cl->prediction * cl->numerosity;
-									}
-									deletions.push_back(d);
-								}
-							}
-							cl_star->prediction = cl_star->prediction / cl_star->numerosity;
-
-							int del_size = deletions.size();
-							if (del_size >0) {
-								//std::cout << "Cl*: (" << cl_star->numerosity << ") " << cl_star->cond << ":" << cl_star->rule.act << "->" << cl_star->prediction << std::endl;
-								for (int m = del_size-1; m >= 0; m--) {
-									//std::cout << compose_cond(clCombSet[deletions[m]]->rule.elements) << ":" << clCombSet[deletions[m]]->rule.act << "->" << clCombSet[deletions[m]]->prediction << " is DELETED." << std::endl;
-									delete_classifier(pop, clCombSet[deletions[m]]);
-									delete_classifier(clCombSet, clCombSet[deletions[m]]);
-								}
-							}
-
-							const double exp_lim = 1 / BETA;
-							cl_star->prediction_error =
-							    (cl_star->experience <= floor(exp_lim))
-							        ? std::abs(cl_star->prediction - PREDICTION_INIT) / cl_star->experience
-							        : (std::abs(cl_star->prediction - PREDICTION_INIT) / exp_lim) *
-							              pow(1 - BETA, cl_star->experience - floor(exp_lim));
-							cl_star->fitness = (FITNESS_INIT - 1) * pow(1 - BETA, cl_star->experience) + 1;
-							cl_star->disproving = 0;
-							//std::cout << "Comb Pred: " << cl_star->prediction << " Exp: " << cl_star->experience << "; Fitness: " << cl_star->fitness << std::endl;
-
-							// adds cl_star to combining set
-							clCombSet.push_back(cl_star);
-							combSetSize = clCombSet.size();
-
-							insert_into_population(pop, cl_star);
-
-							not_combined = 0;
-							j=i;
-						}
-					}
-				}
-		} while (not_combined < 2);
+	if (cache)
+		cache->end();
+	cursor.started = false;
+	return true;
+}
 
+/// Sorts pop and splits it into one population per action of the action
+/// space, followed by one for the classifiers with any other action
+void
+split_actions(const ActionSpace& as, Population& pop, vector<Population>& parts) {
+	sort_population(pop);
+	parts.resize(as.size() + 1);
+	for (Population& part : parts) {
+		part.clear();
+		part.set_binary(pop.binary());
 	}
+	for (size_t cl = 0; cl < pop.size(); cl++)
+		parts[std::min<size_t>(pop.act(cl), as.size())].push_back(pop, cl);
+}
+
+/// Writes the combined parts back into pop and removes the outliers.
+/// Returns true if it has removed any.
+bool
+join_actions(const vector<Population>& parts, Population& pop) {
+	bool modified = false;
+
+	const bool binary = pop.binary();
+	pop.clear();
+	pop.set_binary(binary);
+	for (const Population& part : parts)
+		for (size_t cl = 0; cl < part.size(); cl++)
+			pop.push_back(part, cl);
 
 	if (MAX_DISP_RATE > 0) { // zero means no outlier detection
-		for (auto& cl : pop)
-			if (cl->disproves) {
-				cl->disproving++;
-				cl->disproves = false;
+		for (size_t cl = 0; cl < pop.size(); cl++)
+			if (pop.disproves(cl)) {
+				pop.disproving(cl)++;
+				pop.set_disproves(cl, false);
 			}
 		modified |= remove_outlier(pop);
 	}
@@ -751,18 +1119,176 @@ combine_set(const ActionSpace& as, ClassifierSet& pop) {
 	return modified;
 }
 
-void print_pop(ClassifierSet pop, bool onlyExp) {
-	//std::sort(pop.begin(), pop.end(), [](const ClassifierPtr& l, const ClassifierPtr& r) { return *l < *r; });
+bool
+combine_set(const ActionSpace& as, Population& pop, unsigned int threads, vector<DisprovalCache>* caches) {
+	CombiningBuffers buffers;
+	return combine_set(as, pop, buffers, threads, caches);
+}
+
+bool
+combine_set(const ActionSpace& as, Population& pop, CombiningBuffers& buffers, unsigned int threads,
+            vector<DisprovalCache>* caches) {
+	// every action is combined in a population of its own, classifiers with
+	// an action outside of the action space are left alone
+	vector<Population>& parts = buffers.parts;
+	split_actions(as, pop, parts);
+	buffers.cursors.resize(as.size());
+
+	if (caches)
+		caches->resize(as.size());
+	if (threads == 0)
+		threads = std::thread::hardware_concurrency();
+	// a thread costs more than combining a few classifiers
+	threads = std::min<size_t>(threads, pop.size() / COMBINING_CLASSIFIERS_PER_THREAD);
+	threads = std::max<unsigned int>(1, std::min<size_t>(threads, as.size()));
+	auto work = [&](unsigned int worker) {
+		for (size_t action = worker; action < as.size(); action += threads) {
+			size_t budget = SIZE_MAX;
+			buffers.cursors[action].started = false;
+			combine_action(parts[action], buffers.cursors[action], caches ? &(*caches)[action] : nullptr, budget);
+		}
+	};
+	vector<std::thread> workers;
+	for (unsigned int w = 1; w < threads; w++)
+		workers.emplace_back(work, w);
+	work(0);
+	for (std::thread& worker : workers)
+		worker.join();
+
+	return join_actions(parts, pop);
+}
+
+bool
+combine_set(const ActionSpace& as, Population& pop, CombiningPass& pass, size_t budget,
+            vector<DisprovalCache>* caches) {
+	if (!pass.running) {
+		pass.running = true;
+		pass.snapshot = pop;
+		pass.combined = pop;
+		split_actions(as, pass.combined, pass.parts);
+		// the cursors keep their scratch storage from the last pass
+		pass.cursors.resize(as.size());
+		for (CombineCursor& cursor : pass.cursors)
+			cursor.started = false;
+		pass.action = 0;
+		if (caches)
+			caches->resize(as.size());
+	}
+	for (; pass.action < as.size(); pass.action++)
+		if (!combine_action(pass.parts[pass.action], pass.cursors[pass.action],
+		                    caches ? &(*caches)[pass.action] : nullptr, budget))
+			return false;
+
+	join_actions(pass.parts, pass.combined);
+	reconcile_combined(pass.snapshot, pop, pass.combined, pass.reconcile);
+	std::swap(pop, pass.combined);
+	pass.running = false;
+	return true;
+}
+
+/// Returns true if the condition of classifier i of a subsumes the one of
+/// classifier j of b, both populations having the same condition layout
+bool
+rule_subsumes(const Population& a, size_t i, const Population& b, size_t j) {
+	if (a.act(i) != b.act(j))
+		return false;
+	if (a.binary())
+		return bits_subsume(a.care(i), a.value(i), b.care(j), b.value(j), a.cond_words());
+	return bounds_subsume(a.lower(i), a.upper(i), b.lower(j), b.upper(j), a.cond_len());
+}
+
+void
+reconcile_combined(const Population& snapshot, const Population& live, Population& combined) {
+	ReconcileScratch scratch;
+	reconcile_combined(snapshot, live, combined, scratch);
+}
+
+void
+reconcile_combined(const Population& snapshot, const Population& live, Population& combined,
+                   ReconcileScratch& scratch) {
+	index_ids(live, scratch.live);
+	index_ids(snapshot, scratch.snapshot);
+	index_ids(combined, scratch.combined);
+
+	// merged classifiers, the only ones that can have absorbed others
+	ClassifierSet& stars = scratch.stars;
+	stars.clear();
+	for (size_t cl = 0; cl < combined.size(); cl++)
+		if (index_of_id(scratch.snapshot, combined.id(cl)) == SIZE_MAX)
+			stars.push_back(cl);
+
+	// signed, as deletions in live can use up a classifier
+	vector<long>& numerosity = scratch.numerosity;
+	numerosity.resize(combined.size());
+	for (size_t cl = 0; cl < combined.size(); cl++)
+		numerosity[cl] = combined.numerosity(cl);
+
+	for (size_t s = 0; s < snapshot.size(); s++) {
+		const size_t l = index_of_id(scratch.live, snapshot.id(s));
+		const bool deleted = l == SIZE_MAX;
+		const size_t c = index_of_id(scratch.combined, snapshot.id(s));
+		const bool survived = c != SIZE_MAX;
+		size_t target = combined.size();
+		if (survived) {
+			target = c;
+		} else if (snapshot.experience(s) > 0) {
+			// inexperienced classifiers are dropped by combining, not absorbed
+			for (size_t star : stars)
+				if (rule_subsumes(combined, star, snapshot, s)) {
+					target = star;
+					break;
+				}
+		}
+		if (target == combined.size())
+			continue;
+
+		const long live_numerosity = deleted ? 0 : live.numerosity(l);
+		const long num_change = live_numerosity - (long) snapshot.numerosity(s);
+		const unsigned int exp_change = deleted ? 0 : live.experience(l) - snapshot.experience(s);
+		combined.set_experience(target, combined.experience(target) + exp_change);
+		if (survived) {
+			if (!deleted) {
+				combined.set_prediction(target, live.prediction(l));
+				combined.prediction_error(target) = live.prediction_error(l);
+				combined.set_fitness(target, live.fitness(l));
+				combined.set_actionset_size(target, live.actionset_size(l));
+				if (live.stamp(l) > snapshot.clock())
+					combined.touch(target);
+			}
+		} else if (numerosity[target] + num_change > 0) {
+			// as if the parent had been absorbed with its current prediction
+			const double predictions = combined.prediction(target) * numerosity[target] +
+			                           (deleted ? 0 : live.prediction(l)) * live_numerosity -
+			                           snapshot.prediction(s) * snapshot.numerosity(s);
+			combined.set_prediction(target, predictions / (numerosity[target] + num_change));
+		}
+		numerosity[target] += num_change;
+	}
+
+	ClassifierSet& victims = scratch.victims;
+	victims.clear();
+	for (size_t cl = 0; cl < combined.size(); cl++) {
+		if (numerosity[cl] > 0)
+			combined.set_numerosity(cl, numerosity[cl]);
+		else
+			victims.push_back(cl);
+	}
+	combined.erase(victims);
+	for (size_t cl = 0; cl < live.size(); cl++)
+		if (index_of_id(scratch.snapshot, live.id(cl)) == SIZE_MAX)
+			combined.touch(combined.push_back(live, cl));
+}
 
+void print_pop(const Population& pop, bool onlyExp) {
 	std::cout << "No;Cond;Act;Pred;Fit;PredErr;Num;Exp" << std::endl;
 	size_t j = 0;
-	for (auto& cl : pop) {
-		if (cl->experience > 0)
-			std::cout << ++j << ";" << *cl << std::endl;
+	for (size_t cl = 0; cl < pop.size(); cl++) {
+		if (pop.experience(cl) > 0)
+			std::cout << ++j << ";" << pop.get(cl) << std::endl;
 	}
 	if (!onlyExp)
-		for (auto& cl : pop) {
-			if (cl->experience == 0)
-				std::cout << ++j << ";" << *cl << std::endl;
+		for (size_t cl = 0; cl < pop.size(); cl++) {
+			if (pop.experience(cl) == 0)
+				std::cout << ++j << ";" << pop.get(cl) << std::endl;
 		}
 }
@@ -0,0 +1,456 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+
+#include <match_kernels.hpp>
+#include <overlap_index.hpp>
+#include <population.hpp>
+#include <xcs.hpp>
+#include <XCSLearner.hpp>
+
+using bench_clock = std::chrono::steady_clock;
+
+/// Heap allocations so far, counted by the replaced operator new
+size_t allocations = 0;
+
+void*
+operator new(size_t size) {
+	allocations++;
+	if (void* p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void
+operator delete(void* p) noexcept {
+	std::free(p);
+}
+
+/// Returns the average nanoseconds per call of f over the given number of
+/// runs, taking the best of five repetitions
+template <typename F>
+double
+time_ns(size_t runs, F f) {
+	double best = 0;
+	for (int rep = 0; rep < 5; rep++) {
+		const auto start = bench_clock::now();
+		for (size_t r = 0; r < runs; r++)
+			f();
+		const auto end = bench_clock::now();
+		const double ns = std::chrono::duration<double, std::nano>(end - start).count() / runs;
+		if (rep == 0 || ns < best)
+			best = ns;
+	}
+	return best;
+}
+
+/// Times a scan over n classifiers with intervals of the given maximal
+/// radius around random centers. Wide intervals make the kernels look at more
+/// dimensions before a classifier is rejected.
+///
+/// Every scan gets the next of a few hundred inputs, like the trials of a
+/// learner. Scanning the same input over and over lets the branch predictor
+/// learn which classifiers match, which flatters the scalar path.
+void
+bench_match(size_t n, size_t len, double radius) {
+	std::mt19937 gen(1);
+	std::uniform_real_distribution<double> dis(0, 1);
+
+	vector<double> lower, upper, inputs;
+	for (size_t i = 0; i < n * len; i++) {
+		const double center = dis(gen);
+		const double r = radius * dis(gen);
+		lower.push_back(center - r);
+		upper.push_back(center + r);
+	}
+	const size_t num_inputs = 256;
+	for (size_t k = 0; k < num_inputs * len; k++)
+		inputs.push_back(dis(gen));
+
+	const char* names[] = {"scalar", "avx2", "avx512"};
+	const MatchPath paths[] = {MatchPath::Scalar, MatchPath::AVX2, MatchPath::AVX512};
+	ClassifierSet out;
+	out.reserve(n);
+	for (size_t p = 0; p < 3; p++) {
+		if (!match_path_supported(paths[p]))
+			continue;
+		const BoundsMatchKernel kernel = match_kernel(paths[p]);
+		size_t next = 0, matches = 0;
+		const double ns = time_ns(2000, [&]() {
+			out.clear();
+			kernel(lower.data(), upper.data(), n, len, inputs.data() + (next++ % num_inputs) * len, out);
+			matches += out.size();
+		});
+		std::printf("match  n=%zu len=%-3zu radius=%.2f %-7s %10.0f ns/scan  (%.1f matches)\n", n, len, radius, names[p], ns,
+		            (double) matches / next);
+	}
+}
+
+/// Times matching a binary population of n classifiers with the given
+/// fraction of # positions, once by scanning and once through the index
+void
+bench_binary_match(size_t n, size_t len, double dont_care) {
+	std::mt19937 gen(1);
+	std::uniform_real_distribution<double> dis(0, 1);
+
+	Population pop;
+	pop.set_binary(true);
+	pop.set_match_index(true);
+	for (size_t c = 0; c < n; c++) {
+		Classifier cl;
+		for (size_t k = 0; k < len; k++) {
+			const double v = dis(gen) < 0.5 ? 0.0 : 1.0;
+			const bool hash = dis(gen) < dont_care;
+			cl.rule.elements.push_back(hash ? 0.0 : v);
+			cl.rule.elements.push_back(hash ? 1.0 : v);
+		}
+		pop.push_back(cl);
+	}
+	std::string state;
+	for (size_t k = 0; k < len; k++)
+		state += dis(gen) < 0.5 ? '0' : '1';
+	const Input input = transform_input(state);
+
+	ClassifierSet out;
+	out.reserve(n);
+	const double scan = time_ns(2000, [&]() {
+		out.clear();
+		for (size_t c = 0; c < pop.size(); c++)
+			if (bits_match(pop.care(c), pop.value(c), input.bits.data(), pop.cond_words()))
+				out.push_back(c);
+	});
+	const double indexed = time_ns(2000, [&]() {
+		out.clear();
+		pop.match_index()->match(input.bits.data(), out);
+	});
+	std::printf("binary n=%zu len=%-3zu #=%.2f scan %8.0f ns  index %8.0f ns  (%zu matches)\n", n, len, dont_care, scan,
+	            indexed, out.size());
+}
+
+/// Times finding the classifiers that overlap a query among n classifiers
+/// with intervals of the given maximal radius, once by scanning and once
+/// through the overlap index
+void
+bench_overlap(size_t n, size_t len, double radius) {
+	std::mt19937 gen(1);
+	std::uniform_real_distribution<double> dis(0, 1);
+
+	Population pop;
+	for (size_t c = 0; c < n; c++) {
+		Classifier cl;
+		for (size_t k = 0; k < len; k++) {
+			const double center = dis(gen);
+			const double r = radius * dis(gen);
+			cl.rule.elements.push_back(center - r);
+			cl.rule.elements.push_back(center + r);
+		}
+		pop.push_back(cl);
+	}
+	ClassifierSet all(n);
+	for (size_t c = 0; c < n; c++)
+		all[c] = c;
+	OverlapIndex index;
+	index.assign(pop, all);
+
+	vector<double> lower, upper;
+	for (size_t k = 0; k < len; k++) {
+		const double center = dis(gen);
+		const double r = radius * dis(gen);
+		lower.push_back(center - r);
+		upper.push_back(center + r);
+	}
+
+	ClassifierSet out;
+	out.reserve(n);
+	const double scan = time_ns(2000, [&]() {
+		out.clear();
+		for (size_t c = 0; c < n; c++)
+			if (bounds_overlap(pop.lower(c), pop.upper(c), lower.data(), upper.data(), len))
+				out.push_back(c);
+	});
+	const double indexed = time_ns(2000, [&]() {
+		out.clear();
+		index.query(lower.data(), upper.data(), out);
+	});
+	std::printf("overlap n=%zu len=%-3zu radius=%.2f scan %8.0f ns  index %8.0f ns  (%zu overlaps)\n", n, len, radius,
+	            scan, indexed, out.size());
+}
+
+/// Times sorting n real valued classifiers of len dimensions, once in the
+/// order sorting left them and once shuffled, as combining finds them
+void
+bench_sort(size_t n, size_t len) {
+	std::mt19937 gen(1);
+	std::uniform_real_distribution<double> dis(0, 1);
+	Population pop;
+	for (size_t c = 0; c < n; c++) {
+		Classifier cl;
+		for (size_t k = 0; k < len; k++) {
+			const double center = dis(gen);
+			cl.rule.elements.push_back(center - 0.1);
+			cl.rule.elements.push_back(center + 0.1);
+		}
+		cl.rule.act = gen() % 2;
+		cl.prediction = (gen() % 20) * 50;
+		pop.push_back(cl);
+	}
+
+	sort_population(pop);
+	const double sorted = time_ns(200, [&]() { sort_population(pop); });
+	vector<size_t> order(n);
+	for (size_t c = 0; c < n; c++)
+		order[c] = c;
+	double shuffled = 0;
+	for (int rep = 0; rep < 200; rep++) {
+		std::shuffle(order.begin(), order.end(), gen);
+		pop.permute(order);
+		const auto start = bench_clock::now();
+		sort_population(pop);
+		shuffled += std::chrono::duration<double, std::nano>(bench_clock::now() - start).count() / 200;
+	}
+	std::printf("sort n=%zu len=%zu  sorted %8.0f ns  shuffled %8.0f ns\n", n, len, sorted, shuffled);
+}
+
+/// Times deleting a classifier from a binary population of n classifiers
+/// with the match index on, as deletion does, by shifting the classifiers
+/// behind it down and by moving the last one into its place. Each deletion is
+/// followed by an insertion to keep the population at n.
+void
+bench_delete(size_t n, size_t len) {
+	std::mt19937 gen(1);
+	Population pop;
+	pop.set_binary(true);
+	pop.set_match_index(true);
+	vector<Classifier> pool;
+	for (size_t c = 0; c < n; c++) {
+		Classifier cl;
+		for (size_t k = 0; k < len; k++) {
+			const bool hash = gen() % 3 == 0;
+			const double v = gen() % 2;
+			cl.rule.elements.push_back(hash ? 0.0 : v);
+			cl.rule.elements.push_back(hash ? 1.0 : v);
+		}
+		cl.rule.act = gen() % 2;
+		cl.numerosity = 1 + gen() % 4;
+		cl.experience = gen() % 40;
+		cl.fitness = (1 + gen() % 100) / 100.0;
+		cl.actionset_size = 1 + gen() % 20;
+		pool.push_back(cl);
+		pop.push_back(cl);
+	}
+
+	size_t next = 0;
+	const double shifting = time_ns(2000, [&]() {
+		pop.erase(gen() % pop.size());
+		pop.push_back(pool[next++ % n]);
+	});
+	const double swapping = time_ns(2000, [&]() {
+		pop.swap_erase(gen() % pop.size());
+		pop.push_back(pool[next++ % n]);
+	});
+	std::printf("delete n=%zu len=%zu  erase %8.0f ns  swap_erase %8.0f ns\n", n, len, shifting, swapping);
+}
+
+/// Times looking up the rule of every classifier of a binary population of
+/// n classifiers, by scanning it as insertion used to and through its rule
+/// index
+void
+bench_find_rule(size_t n, size_t len) {
+	std::mt19937 gen(1);
+	Population pop;
+	pop.set_binary(true);
+	vector<Classifier> pool;
+	for (size_t c = 0; c < n; c++) {
+		Classifier cl;
+		for (size_t k = 0; k < len; k++) {
+			const bool hash = gen() % 3 == 0;
+			const double v = gen() % 2;
+			cl.rule.elements.push_back(hash ? 0.0 : v);
+			cl.rule.elements.push_back(hash ? 1.0 : v);
+		}
+		cl.rule.act = gen() % 2;
+		pool.push_back(cl);
+		pop.push_back(cl);
+	}
+
+	size_t next = 0, found = 0;
+	const double scan = time_ns(200, [&]() {
+		const Rule& rule = pool[next++ % n].rule;
+		size_t i = 0;
+		while (i < pop.size() && !pop.same_rule(i, rule))
+			i++;
+		found += i;
+	});
+	const double indexed = time_ns(200, [&]() { found += pop.find_rule(pool[next++ % n].rule); });
+	std::printf("find rule n=%zu len=%zu  scan %8.0f ns  index %8.0f ns\n", n, len, scan, indexed);
+}
+
+/// Times updating an action set of n classifiers, out of a population of
+/// 2000, and counts the allocations of the updates after the first one
+void
+bench_update(size_t n) {
+	std::mt19937 gen(1);
+	Population pop;
+	pop.set_binary(true);
+	for (size_t c = 0; c < 2000; c++) {
+		Classifier cl;
+		for (size_t k = 0; k < 11; k++) {
+			const bool hash = gen() % 3 == 0;
+			const double v = gen() % 2;
+			cl.rule.elements.push_back(hash ? 0.0 : v);
+			cl.rule.elements.push_back(hash ? 1.0 : v);
+		}
+		cl.rule.act = gen() % 2;
+		cl.numerosity = 1 + gen() % 4;
+		cl.experience = gen() % 40;
+		cl.prediction = (gen() % 2) * 1000;
+		cl.prediction_error = gen() % 10;
+		cl.fitness = (1 + gen() % 100) / 100.0;
+		cl.actionset_size = 1 + gen() % 20;
+		pop.push_back(cl);
+	}
+	// replacing erroneous classifiers inserts before it deletes
+	pop.reserve(2000 + n);
+	ClassifierSet action_set;
+	for (size_t c = 0; c < n; c++)
+		action_set.push_back(c * (2000 / n));
+
+	const Input input = transform_input("10110011100");
+	ActionSetView view;
+	update_set(input, 0, 1000, action_set, pop, view);
+	const size_t before = allocations;
+	const double ns = time_ns(2000, [&]() { update_set(input, 0, 1000, action_set, pop, view); });
+	std::printf("update n=%zu  %8.0f ns  allocations: %zu\n", n, ns, allocations - before);
+}
+
+/// Times the fitness update of an action set of n classifiers, computing the
+/// accuracies with pow as update_fitness used to and with accuracy_of
+void
+bench_fitness(size_t n) {
+	std::mt19937 gen(1);
+	ActionSetView view;
+	for (size_t k = 0; k < n; k++) {
+		view.experience.push_back(1 + gen() % 40);
+		view.prediction.push_back((gen() % 2) * 1000);
+		view.prediction_error.push_back((gen() % 1000) / 10.0);
+		view.actionset_size.push_back(1 + gen() % 20);
+		view.numerosity.push_back(1 + gen() % 4);
+		view.fitness.push_back((1 + gen() % 100) / 100.0);
+		view.accuracy.push_back(0);
+		view.erroneous.push_back(0);
+	}
+
+	const double with_pow = time_ns(20000, [&]() {
+		double accuracy_sum = 0;
+		for (size_t k = 0; k < n; k++) {
+			const double err = view.prediction_error[k];
+			view.accuracy[k] = err < EPSILON_ZERO ? 1 : ALPHA * std::pow(err / EPSILON_ZERO, -POWER_PARAMETER);
+			accuracy_sum += view.accuracy[k] * view.numerosity[k];
+		}
+		update_fitness(view, accuracy_sum);
+	});
+	const double with_kernel = time_ns(20000, [&]() { update_fitness(view, update_accuracy(view)); });
+	std::printf("fitness n=%zu  pow %8.0f ns  accuracy_of %8.0f ns\n", n, with_pow, with_kernel);
+}
+
+/// Learns the 6 bit multiplexer without combining, then combines the
+/// population once. Combining it again finds nothing left to merge, so it
+/// times and counts the allocations of rejected candidate pairs only, with
+/// and without a warm DisprovalCache.
+void
+bench_combine(bool binary) {
+	const ActionSpace actions = {0, 1};
+	xcs_rc::XCSLearner learner(actions, 1);
+	learner.combining_period = 1000000;
+	learner.set_maxpopsize(800);
+	std::mt19937 gen(3);
+	std::uniform_real_distribution<double> unit(0, 1);
+	for (size_t t = 0; t < 3000; t++) {
+		double state[6];
+		for (double& x : state)
+			x = binary ? unit(gen) >= 0.5 : unit(gen);
+		const int correct = state[2 + 2 * (state[0] >= 0.5) + (state[1] >= 0.5)] >= 0.5;
+		Action act;
+		if (binary) {
+			std::string bits;
+			for (double x : state)
+				bits += x >= 0.5 ? '1' : '0';
+			act = learner.take_action(bits, ActionMode::Explore);
+		} else {
+			act = learner.take_action(state, 6, ActionMode::Explore);
+		}
+		learner.update_with_reward(act, act == correct ? REWARD_MAX : 0);
+	}
+	Population pop = learner.get_population();
+	combine_set(actions, pop, 1);
+
+	for (bool cached : {false, true}) {
+		vector<DisprovalCache> caches;
+		if (cached) {
+			Population warm = pop;
+			combine_set(actions, warm, 1, &caches);
+		}
+
+		// one pair per slice, so that every slice but the first and the
+		// last, which set up and write back, only rejects a pair. The second
+		// pass finds the scratch storage of the first one.
+		CombiningPass pass;
+		vector<DisprovalCache> sliced_caches = caches;
+		size_t pairs = 0, pair_allocations = 0;
+		for (int warm = 0; warm < 2; warm++) {
+			Population sliced = pop;
+			pairs = 0;
+			pair_allocations = 0;
+			for (bool done = false; !done; pairs++) {
+				const size_t before = allocations;
+				done = combine_set(actions, sliced, pass, 1, cached ? &sliced_caches : nullptr);
+				if (pairs > 0 && !done)
+					pair_allocations += allocations - before;
+			}
+		}
+
+		Population whole = pop;
+		const size_t before = allocations;
+		const auto start = bench_clock::now();
+		combine_set(actions, whole, 1, cached ? &caches : nullptr);
+		const double ns = std::chrono::duration<double, std::nano>(bench_clock::now() - start).count();
+		std::printf("combine %-6s cache=%d n=%zu merged=%zu pairs=%zu  %8.0f ns/pair  allocations: %zu per pass, %zu "
+		            "for rejected pairs\n",
+		            binary ? "binary" : "real", cached, pop.size(), pop.size() - whole.size(), pairs, ns / pairs,
+		            allocations - before, pair_allocations);
+	}
+}
+
+int main() {
+	const size_t lens[] = {6, 11, 16, 32, 64};
+	for (size_t len : lens) {
+		bench_match(2000, len, 0.5);
+		bench_match(2000, len, 0.9);
+	}
+	const size_t binary_lens[] = {11, 20, 37, 70, 135};
+	for (size_t len : binary_lens) {
+		bench_binary_match(2000, len, 0.5);
+		bench_binary_match(2000, len, 0.9);
+	}
+	for (size_t len : lens) {
+		bench_overlap(2000, len, 0.05);
+		bench_overlap(2000, len, 0.5);
+	}
+	bench_sort(2000, 6);
+	bench_sort(2000, 32);
+	bench_delete(2000, 11);
+	bench_delete(2000, 70);
+	bench_find_rule(2000, 11);
+	bench_find_rule(2000, 70);
+	bench_update(20);
+	bench_update(200);
+	bench_fitness(20);
+	bench_fitness(200);
+	bench_combine(true);
+	bench_combine(false);
+	return 0;
+}
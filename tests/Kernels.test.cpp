@@ -0,0 +1,1464 @@
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <set>
+#include <tuple>
+
+#include <match_kernels.hpp>
+#include <overlap_index.hpp>
+#include <population.hpp>
+#include <xcs.hpp>
+#include <XCSLearner.hpp>
+
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#define CATCH_CONFIG_NO_POSIX_SIGNALS // catch.hpp predates SIGSTKSZ being non-constant
+#include "catch.hpp"
+
+/// Heap allocations so far, counted by the replaced operator new
+size_t allocations = 0;
+
+void*
+operator new(size_t size) {
+	allocations++;
+	if (void* p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void
+operator delete(void* p) noexcept {
+	std::free(p);
+}
+
+/// Random deinterleaved bounds of n classifiers. Bounds are drawn from a
+/// coarse grid so that inputs often lie exactly on a bound.
+struct RandomBounds {
+	vector<double> lower;
+	vector<double> upper;
+	vector<double> input;
+};
+
+RandomBounds
+random_bounds(size_t n, size_t len, std::mt19937& gen) {
+	std::uniform_int_distribution<int> grid(0, 4);
+	RandomBounds b;
+	for (size_t c = 0; c < n; c++)
+		for (size_t k = 0; k < len; k++) {
+			double lo = grid(gen) / 4.0;
+			double up = grid(gen) / 4.0;
+			if (lo > up) std::swap(lo, up);
+			b.lower.push_back(lo);
+			b.upper.push_back(up);
+		}
+	for (size_t k = 0; k < len; k++)
+		b.input.push_back(grid(gen) / 4.0);
+	return b;
+}
+
+TEST_CASE( "vector paths match like the scalar path", "[match]" ) {
+	std::mt19937 gen(7);
+	const MatchPath paths[] = {MatchPath::AVX2, MatchPath::AVX512};
+
+	for (size_t len = 1; len <= 19; len++) {
+		for (int round = 0; round < 50; round++) {
+			// few dimensions to get matches at all, a lot of classifiers for longer conditions
+			const RandomBounds b = random_bounds(len < 4 ? 20 : 400, len, gen);
+			const size_t n = b.lower.size() / len;
+
+			ClassifierSet expected;
+			match_bounds_scalar(b.lower.data(), b.upper.data(), n, len, b.input.data(), expected);
+
+			for (MatchPath path : paths) {
+				if (!match_path_supported(path))
+					continue;
+				ClassifierSet actual;
+				match_kernel(path)(b.lower.data(), b.upper.data(), n, len, b.input.data(), actual);
+				REQUIRE(actual == expected);
+			}
+			ClassifierSet dispatched;
+			match_bounds(b.lower.data(), b.upper.data(), n, len, b.input.data(), dispatched);
+			REQUIRE(dispatched == expected);
+		}
+	}
+}
+
+TEST_CASE( "bounds are inclusive", "[match]" ) {
+	const double lower[] = {0.25, 0.5, 0.0, 0.0, 0.1};
+	const double upper[] = {0.25, 0.75, 1.0, 0.0, 0.9};
+	const double inside[] = {0.25, 0.75, 1.0, 0.0, 0.1};
+	const double outside[] = {0.25, 0.75, 1.0, 0.0, 0.95};
+	const MatchPath paths[] = {MatchPath::Scalar, MatchPath::AVX2, MatchPath::AVX512};
+
+	for (MatchPath path : paths) {
+		if (!match_path_supported(path))
+			continue;
+		ClassifierSet hit;
+		match_kernel(path)(lower, upper, 1, 5, inside, hit);
+		REQUIRE(hit.size() == 1);
+		ClassifierSet miss;
+		match_kernel(path)(lower, upper, 1, 5, outside, miss);
+		REQUIRE(miss.empty());
+	}
+}
+
+/// A random binary classifier with roughly half of its positions set to #
+Classifier
+random_binary_classifier(size_t len, std::mt19937& gen) {
+	std::uniform_int_distribution<int> trit(0, 3);
+	Classifier cl;
+	for (size_t k = 0; k < len; k++) {
+		const int t = trit(gen);
+		cl.rule.elements.push_back(t == 1 ? 1.0 : 0.0);
+		cl.rule.elements.push_back(t == 0 ? 0.0 : 1.0);
+	}
+	cl.rule.act = trit(gen) % 2;
+	return cl;
+}
+
+/// n distinct random indices below size, sorted
+ClassifierSet
+random_victims(size_t n, size_t size, std::mt19937& gen) {
+	std::set<size_t> victims;
+	while (victims.size() < n)
+		victims.insert(gen() % size);
+	return ClassifierSet(victims.begin(), victims.end());
+}
+
+/// n random binary inputs of len bits
+vector<Input>
+random_binary_inputs(size_t n, size_t len, std::mt19937& gen) {
+	std::uniform_int_distribution<int> bit(0, 1);
+	vector<Input> inputs;
+	for (size_t i = 0; i < n; i++) {
+		std::string state;
+		for (size_t k = 0; k < len; k++)
+			state += bit(gen) ? '1' : '0';
+		inputs.push_back(transform_input(state));
+	}
+	return inputs;
+}
+
+/// Matches every input in inputs through the index and by scanning
+void
+require_index_matches_scan(const Population& pop, const vector<Input>& inputs) {
+	REQUIRE(pop.match_index() != nullptr);
+	REQUIRE(pop.match_index()->size() == pop.size());
+	for (const Input& input : inputs) {
+		ClassifierSet expected;
+		for (size_t c = 0; c < pop.size(); c++)
+			if (bits_match(pop.care(c), pop.value(c), input.bits.data(), pop.cond_words()))
+				expected.push_back(c);
+		ClassifierSet actual;
+		pop.match_index()->match(input.bits.data(), actual);
+		REQUIRE(actual == expected);
+	}
+}
+
+TEST_CASE( "inverted index matches like scanning the population", "[match]" ) {
+	std::mt19937 gen(11);
+	const size_t lens[] = {3, 11, 64, 70, 130};
+
+	for (size_t len : lens) {
+		const vector<Input> inputs = random_binary_inputs(20, len, gen);
+
+		Population pop;
+		pop.set_binary(true);
+		pop.set_match_index(true);
+		for (int c = 0; c < 300; c++)
+			pop.push_back(random_binary_classifier(len, gen));
+		require_index_matches_scan(pop, inputs);
+
+		// erase across word boundaries, including the first and last classifier
+		pop.erase(ClassifierSet{0, 63, 64, 100, 127, 200, pop.size() - 1});
+		require_index_matches_scan(pop, inputs);
+		pop.erase(pop.size() / 2);
+		require_index_matches_scan(pop, inputs);
+
+		for (int c = 0; c < 40; c++)
+			pop.push_back(random_binary_classifier(len, gen));
+		vector<size_t> order(pop.size());
+		for (size_t i = 0; i < order.size(); i++)
+			order[i] = order.size() - 1 - i;
+		pop.permute(order);
+		require_index_matches_scan(pop, inputs);
+
+		ClassifierSet all(pop.size());
+		std::iota(all.begin(), all.end(), 0);
+		pop.erase(all);
+		REQUIRE(pop.empty());
+		require_index_matches_scan(pop, inputs);
+	}
+}
+
+TEST_CASE( "inverted index is only kept for binary populations", "[match]" ) {
+	Population pop;
+	pop.set_match_index(true);
+	REQUIRE(pop.match_index() == nullptr);
+	pop.set_binary(true);
+	REQUIRE(pop.match_index() != nullptr);
+	pop.set_match_index(false);
+	REQUIRE(pop.match_index() == nullptr);
+}
+
+/// Queries the overlap index with random boxes and compares with a scan
+/// over the given classifiers
+void
+require_overlaps_match_scan(const Population& pop, const OverlapIndex& index, const ClassifierSet& indexed,
+                            std::mt19937& gen) {
+	REQUIRE(index.size() == indexed.size());
+	for (int q = 0; q < 50; q++) {
+		const RandomBounds query = random_bounds(1, pop.cond_len(), gen);
+		ClassifierSet expected;
+		for (size_t cl : indexed)
+			if (bounds_overlap(pop.lower(cl), pop.upper(cl), query.lower.data(), query.upper.data(), pop.cond_len()))
+				expected.push_back(cl);
+		ClassifierSet actual;
+		index.query(query.lower.data(), query.upper.data(), actual);
+		std::sort(expected.begin(), expected.end());
+		std::sort(actual.begin(), actual.end());
+		REQUIRE(actual == expected);
+	}
+}
+
+TEST_CASE( "overlap index finds the overlapping classifiers", "[combine]" ) {
+	std::mt19937 gen(13);
+	const size_t len = 4;
+	const RandomBounds bounds = random_bounds(300, len, gen);
+	Population pop;
+	for (size_t c = 0; c < 300; c++) {
+		Classifier cl;
+		for (size_t k = 0; k < len; k++) {
+			cl.rule.elements.push_back(bounds.lower[c * len + k]);
+			cl.rule.elements.push_back(bounds.upper[c * len + k]);
+		}
+		pop.push_back(cl);
+	}
+	// index every other classifier, like the classifiers of one action
+	ClassifierSet indexed;
+	for (size_t c = 0; c < pop.size(); c += 2)
+		indexed.push_back(c);
+	OverlapIndex index;
+	index.assign(pop, indexed);
+	require_overlaps_match_scan(pop, index, indexed, gen);
+
+	for (int round = 0; round < 10; round++) {
+		ClassifierSet victims;
+		for (int v = 0; v < 8; v++)
+			victims.push_back(indexed[gen() % indexed.size()]);
+		victims.push_back(gen() % pop.size());
+		std::sort(victims.begin(), victims.end());
+		victims.erase(std::unique(victims.begin(), victims.end()), victims.end());
+		// deleted the way combining does, the last classifiers move
+		ClassifierSet kept;
+		for (size_t cl : indexed)
+			if (index_after_deleting(cl, victims, pop.size()) != SIZE_MAX)
+				kept.push_back(index_after_deleting(cl, victims, pop.size()));
+		index.swap_erase(victims, pop.size());
+		for (auto it = victims.rbegin(); it != victims.rend(); it++)
+			delete_classifier(pop, *it);
+		indexed.swap(kept);
+
+		for (int n = 0; n < 6; n++) {
+			Classifier cl = pop.get(indexed[gen() % indexed.size()]);
+			cl.rule.elements[0] -= 0.25;
+			indexed.push_back(pop.push_back(cl));
+			index.insert(pop, indexed.back());
+		}
+		require_overlaps_match_scan(pop, index, indexed, gen);
+	}
+}
+
+/// The key of a binary condition, from its first 32 printed characters
+uint64_t
+printed_cond_key(const Classifier& cl) {
+	const string cond = compose_cond(cl.rule.elements);
+	uint64_t key = 0;
+	for (size_t n = 0; n < 32; n++)
+		key = (key << 2) | (n >= cond.size() ? 0 : cond[n] == '1' ? 1 : cond[n] == '#' ? 2 : 0);
+	return key;
+}
+
+TEST_CASE( "condition keys order like the first positions of the conditions", "[population]" ) {
+	std::mt19937 gen(7);
+	for (size_t len : {1, 6, 20, 70}) {
+		Population binary;
+		binary.set_binary(true);
+		for (int c = 0; c < 50; c++) {
+			const Classifier cl = random_binary_classifier(len, gen);
+			binary.push_back(cl);
+			REQUIRE(binary.cond_key(binary.size() - 1) == printed_cond_key(cl));
+		}
+
+		// bounds on a grid of quarters quantise apart once clamped to [0, 1]
+		const double bounds[] = {0.0, 1.0, 0.25, 0.5, 0.75, -3.5, 12345.678, 1e300};
+		std::uniform_int_distribution<int> pick(0, 7);
+		Population real;
+		vector<vector<double>> clamped;
+		for (int c = 0; c < 200; c++) {
+			Classifier cl;
+			clamped.emplace_back();
+			for (size_t k = 0; k < len; k++) {
+				double lo = bounds[pick(gen) % (c < 50 ? 2 : 8)];
+				double up = bounds[pick(gen) % (c < 50 ? 2 : 8)];
+				if (lo > up)
+					std::swap(lo, up);
+				cl.rule.elements.push_back(lo);
+				cl.rule.elements.push_back(up);
+				if (k < 4) {
+					clamped.back().push_back(std::min(std::max(lo, 0.0), 1.0));
+					clamped.back().push_back(std::min(std::max(up, 0.0), 1.0));
+				}
+			}
+			real.push_back(cl);
+		}
+		for (size_t a = 0; a < real.size(); a++)
+			for (size_t b = 0; b < real.size(); b++) {
+				REQUIRE((real.cond_key(a) < real.cond_key(b)) == (clamped[a] < clamped[b]));
+				REQUIRE((real.cond_key(a) == real.cond_key(b)) == (clamped[a] == clamped[b]));
+			}
+	}
+}
+
+TEST_CASE( "sorting orders by action, descending prediction, condition and id", "[population]" ) {
+	std::mt19937 gen(11);
+	const double predictions[] = {-1000.0, -0.5, -0.0, 0.0, 1e-300, 0.5, 10.0, 1000.0};
+	Population pop;
+	pop.set_binary(true);
+	for (int c = 0; c < 300; c++) {
+		Classifier cl = random_binary_classifier(3, gen);
+		cl.rule.act = gen() % 3;
+		cl.prediction = predictions[gen() % 8];
+		pop.push_back(cl);
+	}
+	vector<std::pair<uint64_t, Classifier>> before;
+	for (size_t c = 0; c < pop.size(); c++)
+		before.push_back(std::make_pair(pop.id(c), pop.get(c)));
+
+	sort_population(pop);
+	REQUIRE(pop.size() == before.size());
+	for (size_t c = 0; c < pop.size(); c++) {
+		// rows move with their parameters
+		const auto it = std::find_if(before.begin(), before.end(), [&](const std::pair<uint64_t, Classifier>& b) {
+			return b.first == pop.id(c);
+		});
+		REQUIRE(it != before.end());
+		REQUIRE(pop.get(c).rule.elements == it->second.rule.elements);
+		REQUIRE(pop.prediction(c) == it->second.prediction);
+		if (c == 0)
+			continue;
+		const auto prev = std::make_tuple(pop.act(c - 1), -pop.prediction(c - 1), pop.cond_key(c - 1), pop.id(c - 1));
+		const auto next = std::make_tuple(pop.act(c), -pop.prediction(c), pop.cond_key(c), pop.id(c));
+		REQUIRE(prev < next);
+	}
+}
+
+TEST_CASE( "typed inputs load like parsed strings", "[input]" ) {
+	const Input parsed_real = transform_input("0.25;0.5;1;0");
+	const double doubles[] = {0.25, 0.5, 1, 0};
+	const float floats[] = {0.25f, 0.5f, 1.0f, 0.0f};
+	Input input;
+	load_input(input, doubles, 4);
+	REQUIRE(!input.binary);
+	REQUIRE(input.len == parsed_real.len);
+	REQUIRE(input.values == parsed_real.values);
+	load_input(input, floats, 4);
+	REQUIRE(input.values == parsed_real.values);
+
+	std::string state;
+	for (int k = 0; k < 70; k++)
+		state += (k % 3 == 0) ? '1' : '0';
+	const Input parsed_binary = transform_input(state);
+	// bits past the length are ignored
+	vector<uint64_t> bits = parsed_binary.bits;
+	bits[1] |= ~(uint64_t) 0 << 6;
+	load_input(input, bits.data(), 70);
+	REQUIRE(input.binary);
+	REQUIRE(input.len == 70);
+	REQUIRE(input.values.empty());
+	REQUIRE(input.bits == parsed_binary.bits);
+}
+
+TEST_CASE( "generators are reproducible per seed and stream", "[random]" ) {
+	Rng a(5), b(5), c(5, 1), d(6);
+	bool differs_by_stream = false;
+	bool differs_by_seed = false;
+	for (int i = 0; i < 100; i++) {
+		const uint64_t x = a.next();
+		REQUIRE(x == b.next());
+		differs_by_stream |= x != c.next();
+		differs_by_seed |= x != d.next();
+	}
+	REQUIRE(differs_by_stream);
+	REQUIRE(differs_by_seed);
+
+	c.seed(5);
+	a.seed(5);
+	REQUIRE(a.next() == c.next());
+}
+
+TEST_CASE( "streams are jumps of the generator", "[random]" ) {
+	Rng a(5, 3), b(5);
+	for (int j = 0; j < 3; j++)
+		b.jump();
+	for (int i = 0; i < 10; i++)
+		REQUIRE(a.next() == b.next());
+
+	// large stream ids, such as hashes, take a jump per set bit only
+	const uint64_t stream = 0xdeadbeefcafef00dull;
+	Rng c(5, stream), d(5, stream), e(5, stream - 1), f(5, stream + 1);
+	e.jump();
+	bool differs = false;
+	for (int i = 0; i < 10; i++) {
+		const uint64_t x = c.next();
+		REQUIRE(x == d.next());
+		REQUIRE(x == e.next());
+		differs |= x != f.next();
+	}
+	REQUIRE(differs);
+	Rng g(5, ~(uint64_t) 0);
+	REQUIRE(g.next() != Rng(5).next());
+}
+
+TEST_CASE( "generators stay in range", "[random]" ) {
+	Rng rng(1);
+	vector<int> seen(5, 0);
+	for (int i = 0; i < 10000; i++) {
+		const unsigned u = rng.uniform_uint(3, 7);
+		REQUIRE(u >= 3);
+		REQUIRE(u <= 7);
+		seen[u - 3]++;
+		const double x = rng.uniform(-1, 2);
+		REQUIRE(x >= -1);
+		REQUIRE(x < 2);
+	}
+	for (int n : seen)
+		REQUIRE(n > 1800);
+	REQUIRE(rng.uniform_uint(4, 4) == 4);
+	rng.uniform_uint(0, 0xffffffffu);
+}
+
+/// How run_multiplexer6 hands the states to the learner
+enum class StateForm {
+	String, // bits as '0' and '1'
+	Packed, // bits packed into a word
+	Real, // values uniform in [0, 1), a value of at least 0.5 standing for a 1
+};
+
+/// Runs trials of the 6 bit multiplexer, alternating explore and exploit
+void
+run_multiplexer6(xcs_rc::XCSLearner& learner, size_t trials, std::mt19937& gen,
+                 StateForm form = StateForm::String) {
+	std::uniform_int_distribution<int> bit(0, 1);
+	std::uniform_real_distribution<double> unit(0, 1);
+	for (size_t t = 0; t < trials; t++) {
+		double state[6];
+		uint64_t bits = 0;
+		std::string string;
+		for (size_t k = 0; k < 6; k++) {
+			state[k] = form == StateForm::Real ? unit(gen) : bit(gen);
+			bits |= (uint64_t) (state[k] >= 0.5) << k;
+			string += state[k] >= 0.5 ? '1' : '0';
+		}
+		const int correct = state[2 + 2 * (state[0] >= 0.5) + (state[1] >= 0.5)] >= 0.5;
+		const ActionMode mode = (t % 2) ? ActionMode::Explore : ActionMode::Exploit;
+		if (form == StateForm::String) {
+			const Action act = learner.take_action(string, mode);
+			learner.update_with_reward(string, act, act == correct ? REWARD_MAX : 0);
+			continue;
+		}
+		const Action act = form == StateForm::Packed ? learner.take_action(&bits, 6, mode)
+		                                             : learner.take_action(state, 6, mode);
+		learner.update_with_reward(act, act == correct ? REWARD_MAX : 0);
+	}
+}
+
+TEST_CASE( "reserved population storage is reused", "[population]" ) {
+	Population pop;
+	pop.set_binary(true);
+	pop.reserve(100);
+	const Input input = transform_input("010011");
+	// the conditions are only sized once the first one is known
+	for (int c = 0; c < 100; c++)
+		pop.push_back(input, 0);
+	REQUIRE(pop.allocations() == 1);
+	pop.push_back(input, 1);
+	REQUIRE(pop.allocations() == 2);
+
+	pop.clear();
+	pop.set_binary(true);
+	for (int c = 0; c < 101; c++)
+		pop.push_back(input, 0);
+	REQUIRE(pop.allocations() == 2);
+}
+
+TEST_CASE( "covering writes the input into the population", "[population]" ) {
+	const Input input = transform_input("10110");
+	Population pop;
+	pop.set_binary(true);
+	const size_t i = pop.push_back(input, 1);
+	const Classifier cl = pop.get(i);
+	REQUIRE(cl.rule.elements == vector<double>({1, 1, 0, 0, 1, 1, 1, 1, 0, 0}));
+	REQUIRE(cl.rule.act == 1);
+	Classifier fresh;
+	fresh.rule = cl.rule;
+	REQUIRE(cl == fresh);
+
+	Population real;
+	const size_t j = real.push_back(transform_input("0.25;0.5"), 0);
+	REQUIRE(real.get(j).rule.elements == vector<double>({0.25, 0.25, 0.5, 0.5}));
+}
+
+TEST_CASE( "generation changes when indices may change", "[population]" ) {
+	Population pop;
+	pop.set_binary(true);
+	const Input input = transform_input("0110");
+	pop.push_back(input, 0);
+	pop.push_back(input, 1);
+	pop.push_back(input, 0);
+
+	// appending keeps the indices of existing classifiers
+	uint64_t generation = pop.generation();
+	pop.push_back(input, 1);
+	REQUIRE(pop.generation() == generation);
+
+	pop.erase(1);
+	REQUIRE(pop.generation() != generation);
+	generation = pop.generation();
+	pop.permute({2, 1, 0});
+	REQUIRE(pop.generation() != generation);
+	generation = pop.generation();
+	pop.clear();
+	REQUIRE(pop.generation() != generation);
+}
+
+/// Walks the deletion votes linearly and requires the wheel to pick every
+/// classifier for a choice point in the middle of its share of the wheel
+void
+require_wheel_matches_votes(Population& pop) {
+	double total_fitness = 0;
+	unsigned int total_numerosity = 0;
+	for (size_t c = 0; c < pop.size(); c++) {
+		total_fitness += pop.fitness(c);
+		total_numerosity += pop.numerosity(c);
+	}
+	const double mean_fitness = total_fitness / total_numerosity;
+	DeletionWheel& wheel = pop.deletion_wheel();
+	const double vote_sum = wheel.vote_sum();
+	REQUIRE(wheel.size() == pop.size());
+	REQUIRE(wheel.total_numerosity() == total_numerosity);
+	double running = 0;
+	for (size_t c = 0; c < pop.size(); c++) {
+		const double vote = get_del_prop(pop, c, mean_fitness);
+		REQUIRE(wheel.find(running + vote / 2) == c);
+		running += vote;
+	}
+	REQUIRE(vote_sum == Approx(running));
+}
+
+TEST_CASE( "deletion wheel picks classifiers like the linear roulette", "[deletion]" ) {
+	std::mt19937 gen(11);
+	std::uniform_real_distribution<double> fitness(0.01, 1);
+	std::uniform_real_distribution<double> actionset_size(1, 20);
+	std::uniform_int_distribution<unsigned int> numerosity(1, 5);
+	std::uniform_int_distribution<unsigned int> experience(0, 2 * THETA_DEL);
+	Population pop;
+	pop.set_binary(true);
+	for (int c = 0; c < 300; c++) {
+		Classifier cl = random_binary_classifier(8, gen);
+		cl.fitness = fitness(gen);
+		cl.actionset_size = actionset_size(gen);
+		cl.numerosity = numerosity(gen);
+		cl.experience = experience(gen);
+		pop.push_back(cl);
+	}
+	require_wheel_matches_votes(pop);
+
+	// moving the mean fitness up and then down moves classifiers across the
+	// deletion threshold both ways
+	for (int round = 0; round < 5; round++) {
+		for (int u = 0; u < 100; u++) {
+			const size_t c = gen() % pop.size();
+			pop.set_fitness(c, fitness(gen) * (round < 3 ? round + 1 : 5 - round));
+			pop.set_actionset_size(c, actionset_size(gen));
+			pop.set_numerosity(c, numerosity(gen));
+			pop.set_experience(c, experience(gen));
+		}
+		require_wheel_matches_votes(pop);
+	}
+
+	pop.erase(random_victims(50, pop.size(), gen));
+	require_wheel_matches_votes(pop);
+
+	vector<size_t> order;
+	for (size_t c = pop.size(); c-- > 0;)
+		order.push_back(c);
+	pop.permute(order);
+	require_wheel_matches_votes(pop);
+
+	pop.clear();
+	REQUIRE(pop.deletion_wheel().vote_sum() == 0);
+	REQUIRE(pop.deletion_wheel().find(0) == 0);
+}
+
+/// Compares the totals kept by the population with a scan over it
+void
+require_totals_match_scan(const Population& pop) {
+	double fitness = 0;
+	size_t numerosity = 0, experienced = 0, experience = 0;
+	for (size_t c = 0; c < pop.size(); c++) {
+		fitness += pop.fitness(c);
+		numerosity += pop.numerosity(c);
+		experienced += pop.experience(c) > 0;
+		experience += pop.experience(c);
+	}
+	REQUIRE(pop.total_fitness() == Approx(fitness));
+	REQUIRE(pop.total_numerosity() == numerosity);
+	REQUIRE(pop.experienced() == experienced);
+	REQUIRE(pop.total_experience() == experience);
+}
+
+TEST_CASE( "population totals follow every change", "[population]" ) {
+	std::mt19937 gen(5);
+	Population pop;
+	pop.set_binary(true);
+	require_totals_match_scan(pop);
+	for (int c = 0; c < 100; c++) {
+		Classifier cl = random_binary_classifier(8, gen);
+		cl.numerosity = 1 + gen() % 4;
+		cl.experience = gen() % 3;
+		pop.push_back(cl);
+	}
+	require_totals_match_scan(pop);
+	for (int u = 0; u < 200; u++) {
+		const size_t c = gen() % pop.size();
+		pop.set_numerosity(c, 1 + gen() % 4);
+		pop.set_experience(c, gen() % 3);
+		pop.set_fitness(c, (gen() % 100) / 10.0);
+	}
+	require_totals_match_scan(pop);
+	pop.erase(random_victims(30, pop.size(), gen));
+	require_totals_match_scan(pop);
+	pop.clear();
+	require_totals_match_scan(pop);
+
+	xcs_rc::XCSLearner learner({0, 1});
+	learner.combining_period = 40;
+	learner.set_maxpopsize(200);
+	run_multiplexer6(learner, 1000, gen);
+	require_totals_match_scan(learner.get_population());
+	REQUIRE(learner.total_numerosity() == learner.get_population().total_numerosity());
+	REQUIRE(learner.experienced_classifiers() == learner.get_population().experienced());
+}
+
+TEST_CASE( "swap erase moves the last classifier into the gap", "[population]" ) {
+	std::mt19937 gen(13);
+	const vector<Input> inputs = random_binary_inputs(20, 70, gen);
+
+	Population pop;
+	pop.set_binary(true);
+	pop.set_match_index(true);
+	for (int c = 0; c < 300; c++) {
+		Classifier cl = random_binary_classifier(70, gen);
+		cl.fitness = (1 + gen() % 100) / 100.0;
+		cl.actionset_size = 1 + gen() % 20;
+		cl.numerosity = 1 + gen() % 5;
+		cl.experience = gen() % (2 * (unsigned int) THETA_DEL);
+		pop.push_back(cl);
+	}
+
+	// across word boundaries, including the first and the last classifier
+	const size_t victims[] = {0, 63, 64, 100, 127, 200, 293};
+	for (size_t i : victims) {
+		const uint64_t moved = pop.id(pop.size() - 1);
+		pop.swap_erase(i);
+		if (i < pop.size())
+			REQUIRE(pop.id(i) == moved);
+	}
+	require_wheel_matches_votes(pop);
+	require_totals_match_scan(pop);
+	require_index_matches_scan(pop, inputs);
+
+	for (int c = 0; c < 40; c++)
+		pop.push_back(random_binary_classifier(70, gen));
+	while (pop.size() > 1)
+		pop.swap_erase(gen() % pop.size());
+	require_wheel_matches_votes(pop);
+	require_totals_match_scan(pop);
+	require_index_matches_scan(pop, inputs);
+	pop.swap_erase(0);
+	REQUIRE(pop.empty());
+	REQUIRE(pop.deletion_wheel().vote_sum() == 0);
+}
+
+TEST_CASE( "inexperienced classifiers are removed in one pass", "[population]" ) {
+	std::mt19937 gen(17);
+	const vector<Input> inputs = random_binary_inputs(20, 70, gen);
+
+	Population pop;
+	pop.set_binary(true);
+	pop.set_match_index(true);
+	for (int c = 0; c < 300; c++) {
+		Classifier cl = random_binary_classifier(70, gen);
+		cl.fitness = (1 + gen() % 100) / 100.0;
+		cl.actionset_size = 1 + gen() % 20;
+		cl.numerosity = 1 + gen() % 5;
+		// runs of inexperienced classifiers, as covering bursts leave them
+		cl.experience = (c / 7) % 3 == 0 ? 0 : 1 + gen() % (2 * (unsigned int) THETA_DEL);
+		pop.push_back(cl);
+	}
+	vector<uint64_t> kept;
+	for (size_t c = 0; c < pop.size(); c++)
+		if (pop.experience(c) > 0)
+			kept.push_back(pop.id(c));
+
+	const uint64_t generation = pop.generation();
+	REQUIRE(pop.erase_inexperienced() == 300 - kept.size());
+	REQUIRE(pop.generation() != generation);
+	REQUIRE(pop.size() == kept.size());
+	for (size_t c = 0; c < pop.size(); c++)
+		REQUIRE(pop.id(c) == kept[c]);
+	require_wheel_matches_votes(pop);
+	require_totals_match_scan(pop);
+	require_index_matches_scan(pop, inputs);
+
+	REQUIRE(pop.erase_inexperienced() == 0);
+	REQUIRE(pop.size() == kept.size());
+}
+
+TEST_CASE( "action set update follows the update rules", "[update]" ) {
+	std::mt19937 gen(23);
+	Population pop;
+	pop.set_binary(true);
+	for (int c = 0; c < 60; c++) {
+		Classifier cl = random_binary_classifier(6, gen);
+		cl.numerosity = 1 + gen() % 4;
+		cl.actionset_size = 1 + gen() % 30;
+		cl.fitness = (1 + gen() % 100) / 100.0;
+		// both sides of 1 / BETA, and errors on both sides of the tolerances
+		cl.experience = gen() % 14;
+		cl.prediction = (gen() % 11) * 100;
+		const double errors[] = {0, EPSILON_ZERO / 2, 3, PRED_ERR_TOL - 1, PRED_ERR_TOL, 700};
+		cl.prediction_error = errors[gen() % 6];
+		pop.push_back(cl);
+	}
+	ClassifierSet action_set;
+	for (size_t c = 0; c < pop.size(); c++)
+		if (gen() % 3 == 0)
+			action_set.push_back(c);
+
+	// the update rules written out classifier by classifier
+	const double reward = 1000;
+	unsigned int total_numerosity = 0;
+	for (size_t cl : action_set)
+		total_numerosity += pop.numerosity(cl);
+	struct Expected {
+		uint64_t id;
+		unsigned int experience;
+		double prediction, prediction_error, actionset_size, fitness;
+		bool replaced;
+	};
+	vector<Expected> expected;
+	double accuracy_sum = 0;
+	vector<double> accuracy;
+	for (size_t cl : action_set) {
+		Expected e;
+		e.id = pop.id(cl);
+		e.experience = pop.experience(cl) + 1;
+		const bool averaging = e.experience < 1 / BETA;
+		const double p = pop.prediction(cl);
+		e.prediction = averaging ? p + (reward - p) / e.experience : p + BETA * (reward - p);
+		const double as = pop.actionset_size(cl);
+		e.actionset_size = averaging ? as + (total_numerosity - as) / e.experience : total_numerosity;
+		const double err = pop.prediction_error(cl);
+		const double miss = std::abs(reward - e.prediction) - err;
+		e.prediction_error = averaging ? err + miss / e.experience : err + BETA * miss;
+		e.replaced = e.experience >= 2 * MIN_EXP && err <= PRED_ERR_TOL && e.prediction_error > PRED_ERR_TOL;
+		accuracy.push_back(e.prediction_error < EPSILON_ZERO
+		                       ? 1
+		                       : ALPHA * std::pow(e.prediction_error / EPSILON_ZERO, -POWER_PARAMETER));
+		accuracy_sum += accuracy.back() * pop.numerosity(cl);
+		e.fitness = pop.fitness(cl);
+		expected.push_back(e);
+	}
+	size_t replaced = 0;
+	for (size_t k = 0; k < action_set.size(); k++) {
+		const double share = accuracy[k] * pop.numerosity(action_set[k]) / accuracy_sum;
+		expected[k].fitness += BETA * (share - expected[k].fitness);
+		replaced += expected[k].replaced;
+	}
+	REQUIRE(replaced > 0);
+
+	const Input input = transform_input("101100");
+	const size_t size = pop.size();
+	ActionSetView view;
+	REQUIRE(update_set(input, 1, reward, action_set, pop, view));
+	REQUIRE(pop.size() == size);
+	for (const Expected& e : expected) {
+		size_t cl = 0;
+		while (cl < pop.size() && pop.id(cl) != e.id)
+			cl++;
+		REQUIRE((cl == pop.size()) == e.replaced);
+		if (e.replaced)
+			continue;
+		REQUIRE(pop.experience(cl) == e.experience);
+		REQUIRE(pop.prediction(cl) == Approx(e.prediction).epsilon(1e-12));
+		REQUIRE(pop.prediction_error(cl) == Approx(e.prediction_error).epsilon(1e-12));
+		REQUIRE(pop.actionset_size(cl) == Approx(e.actionset_size).epsilon(1e-12));
+		REQUIRE(pop.fitness(cl) == Approx(e.fitness).epsilon(1e-12));
+	}
+	size_t covering = 0;
+	for (size_t cl = 0; cl < pop.size(); cl++)
+		covering += pop.care(cl)[0] == 0x3f && pop.value(cl)[0] == input.bits[0] && pop.experience(cl) == 1;
+	REQUIRE(covering == replaced);
+	require_totals_match_scan(pop);
+	require_wheel_matches_votes(pop);
+}
+
+TEST_CASE( "accuracy and decay follow pow", "[update]" ) {
+	REQUIRE(accuracy_of(0) == 1);
+	REQUIRE(accuracy_of(EPSILON_ZERO / 2) == 1);
+	for (double err = EPSILON_ZERO; err < 2000; err *= 1.37)
+		REQUIRE(accuracy_of(err) == Approx(ALPHA * std::pow(err / EPSILON_ZERO, -POWER_PARAMETER)).epsilon(1e-14));
+	REQUIRE(int_pow<0>(3) == 1);
+	REQUIRE(int_pow<5>(3) == 243);
+	REQUIRE(int_pow<11>(0.5) == std::pow(0.5, 11));
+
+	// the table is computed by pow, and pow takes over where it ends
+	for (unsigned int n = 0; n < 10000; n += 1 + n / 8)
+		REQUIRE(beta_decay(n) == std::pow(1 - BETA, n));
+}
+
+/// Requires find_rule to return the first classifier with the rule of every
+/// classifier in rules, or size() if none has it
+void
+require_rules_found(const Population& pop, const vector<Classifier>& rules) {
+	for (const Classifier& cl : rules) {
+		size_t expected = 0;
+		while (expected < pop.size() && !pop.same_rule(expected, cl.rule))
+			expected++;
+		REQUIRE(pop.find_rule(cl.rule) == expected);
+	}
+}
+
+TEST_CASE( "rule index finds rules like scanning the population", "[population]" ) {
+	std::mt19937 gen(19);
+	std::uniform_int_distribution<int> grid(0, 2);
+	for (bool binary : {true, false}) {
+		// few distinct rules, so that many classifiers share one
+		vector<Classifier> rules;
+		for (int r = 0; r < 60; r++) {
+			Classifier cl = random_binary_classifier(3, gen);
+			if (!binary) {
+				cl.rule.elements.clear();
+				for (int k = 0; k < 2; k++) {
+					const double lo = grid(gen) / 2.0;
+					cl.rule.elements.push_back(lo == 0 ? -0.0 : lo);
+					cl.rule.elements.push_back(lo + grid(gen) / 4.0);
+				}
+			}
+			cl.experience = gen() % 3;
+			rules.push_back(cl);
+		}
+		// bounds no ternary condition has
+		Classifier odd = rules.front();
+		odd.rule.elements[0] = 0.5;
+		odd.rule.elements[1] = 0.5;
+		rules.push_back(odd);
+
+		Population pop;
+		pop.set_binary(binary);
+		require_rules_found(pop, rules);
+		for (int c = 0; c < 200; c++)
+			pop.push_back(rules[gen() % 60]);
+		require_rules_found(pop, rules);
+
+		pop.erase(random_victims(30, pop.size(), gen));
+		require_rules_found(pop, rules);
+		for (int e = 0; e < 30; e++)
+			pop.swap_erase(gen() % pop.size());
+		require_rules_found(pop, rules);
+
+		vector<size_t> order;
+		for (size_t c = pop.size(); c-- > 0;)
+			order.push_back(c);
+		pop.permute(order);
+		require_rules_found(pop, rules);
+		pop.erase_inexperienced();
+		require_rules_found(pop, rules);
+
+		Population part;
+		part.set_binary(binary);
+		for (size_t c = 0; c < pop.size(); c += 2)
+			part.push_back(pop, c);
+		require_rules_found(part, rules);
+		const Population copy = pop;
+		require_rules_found(copy, rules);
+		pop.clear();
+		require_rules_found(pop, rules);
+	}
+}
+
+TEST_CASE( "population storage stops growing in steady state", "[population]" ) {
+	std::mt19937 gen(3);
+	xcs_rc::XCSLearner learner({0, 1});
+	learner.combining_period = 40;
+	learner.set_maxpopsize(400);
+	learner.set_match_index(true);
+
+	run_multiplexer6(learner, 2000, gen);
+	const size_t warm = learner.get_population().allocations();
+	run_multiplexer6(learner, 5000, gen);
+	REQUIRE(learner.get_population().allocations() == warm);
+}
+
+TEST_CASE( "trials allocate nothing in steady state", "[population]" ) {
+	for (bool binary : {true, false}) {
+		std::mt19937 gen(3);
+		xcs_rc::XCSLearner learner({0, 1}, 7);
+		learner.combining_period = 1000000;
+		learner.set_maxpopsize(400);
+		learner.set_match_index(binary);
+
+		const StateForm form = binary ? StateForm::Packed : StateForm::Real;
+		// the first trials grow the buffers the later ones reuse
+		run_multiplexer6(learner, 2000, gen, form);
+		const size_t before = allocations;
+		run_multiplexer6(learner, 2000, gen, form);
+		const size_t trial_allocations = allocations - before;
+		REQUIRE(learner.get_population().size() > 0);
+		REQUIRE(trial_allocations == 0);
+	}
+}
+
+TEST_CASE( "learners with the same seed learn the same population", "[random]" ) {
+	xcs_rc::XCSLearner first({0, 1}, 9);
+	xcs_rc::XCSLearner second({0, 1}, 9);
+	for (xcs_rc::XCSLearner* learner : {&first, &second}) {
+		std::mt19937 gen(3);
+		learner->combining_period = 40;
+		learner->set_maxpopsize(200);
+		run_multiplexer6(*learner, 1000, gen);
+	}
+	const Population& a = first.get_population();
+	const Population& b = second.get_population();
+	REQUIRE(a.size() == b.size());
+	for (size_t i = 0; i < a.size(); i++)
+		REQUIRE(a.get(i) == b.get(i));
+}
+
+TEST_CASE( "combining does not depend on the number of threads", "[combine]" ) {
+	std::mt19937 gen(3);
+	xcs_rc::XCSLearner learner({0, 1});
+	learner.combining_period = 100000;
+	learner.set_maxpopsize(400);
+	run_multiplexer6(learner, 1500, gen);
+
+	Population single = learner.get_population();
+	Population parallel = learner.get_population();
+	combine_set({0, 1}, single, 1);
+	combine_set({0, 1}, parallel, 2);
+	REQUIRE(single.size() < learner.get_population().size());
+	REQUIRE(single.size() == parallel.size());
+	for (size_t i = 0; i < single.size(); i++)
+		REQUIRE(single.get(i) == parallel.get(i));
+}
+
+/// Returns true if two predictions are within PRED_TOL of each other, the
+/// way combining tests it
+bool
+in_window(double p1, double p2) {
+	return p2 + PRED_TOL >= p1 && p2 <= p1 + PRED_TOL;
+}
+
+/// Requires every pair of experienced classifiers of an action within
+/// PRED_TOL of each other to be disproved, by another experienced classifier
+/// of the action that overlaps the hull of their conditions and predicts out
+/// of range of the merged prediction, and returns how many pairs there were
+size_t
+require_no_pair_left(const Population& pop) {
+	size_t pairs = 0;
+	for (size_t i = 0; i < pop.size(); i++)
+		for (size_t j = i + 1; j < pop.size(); j++) {
+			if (pop.act(i) != pop.act(j) || pop.experience(i) < MIN_EXP || pop.experience(j) < MIN_EXP ||
+			    !in_window(pop.prediction(i), pop.prediction(j)))
+				continue;
+			pairs++;
+			const vector<double> a = pop.get(i).rule.elements;
+			const vector<double> b = pop.get(j).rule.elements;
+			vector<double> hull(a.size());
+			for (size_t k = 0; k < a.size(); k += 2) {
+				hull[k] = std::min(a[k], b[k]);
+				hull[k + 1] = std::max(a[k + 1], b[k + 1]);
+			}
+			const double prediction = (pop.prediction(i) * pop.numerosity(i) + pop.prediction(j) * pop.numerosity(j)) /
+			                          (pop.numerosity(i) + pop.numerosity(j));
+			bool disproved = false;
+			for (size_t d = 0; d < pop.size() && !disproved; d++) {
+				if (d == i || d == j || pop.act(d) != pop.act(i) || pop.experience(d) == 0 ||
+				    in_window(prediction, pop.prediction(d)))
+					continue;
+				const vector<double> c = pop.get(d).rule.elements;
+				bool overlaps = true;
+				for (size_t k = 0; k < c.size(); k += 2)
+					overlaps &= c[k] <= hull[k + 1] && hull[k] <= c[k + 1];
+				disproved = overlaps;
+			}
+			REQUIRE(disproved);
+		}
+	return pairs;
+}
+
+TEST_CASE( "combining pairs every candidate within the prediction window", "[combine]" ) {
+	// candidates are ordered by prediction and the pairing jumps over those
+	// out of range to the merged ones, yet every pair in range is examined
+	for (bool binary : {true, false}) {
+		xcs_rc::XCSLearner learner({0, 1}, 7);
+		learner.combining_period = 1000000;
+		learner.set_maxpopsize(400);
+		std::mt19937 gen(5);
+		run_multiplexer6(learner, 2000, gen, binary ? StateForm::String : StateForm::Real);
+
+		Population pop = learner.get_population();
+		combine_set({0, 1}, pop, 1);
+		REQUIRE(pop.size() < learner.get_population().size());
+		REQUIRE(require_no_pair_left(pop) > 0);
+	}
+
+	// predictions a few steps apart, so that the windows overlap in many ways
+	std::mt19937 gen(29);
+	size_t merged = 0;
+	for (int round = 0; round < 200; round++) {
+		Population pop;
+		pop.set_binary(true);
+		for (int c = 0; c < 16; c++) {
+			Classifier cl = random_binary_classifier(5, gen);
+			cl.experience = 1 + gen() % 5;
+			cl.numerosity = 1 + gen() % 3;
+			cl.prediction = (gen() % 8) * 4;
+			pop.push_back(cl);
+		}
+		combine_set({0, 1}, pop, 1);
+		merged += 16 - pop.size();
+		require_no_pair_left(pop);
+	}
+	REQUIRE(merged > 0);
+}
+
+/// Combines the classifiers of every action the way combining did before it
+/// kept a worklist: passes over the candidates, sorted by descending
+/// prediction with the merged ones appended, where a merge restarts its row,
+/// until a pass merges nothing. Returns the classifiers of the actions.
+vector<Classifier>
+combine_in_passes(const ActionSpace& as, Population pop) {
+	sort_population(pop);
+	vector<Classifier> result;
+	for (Action act : as) {
+		vector<Classifier> set;
+		for (size_t cl = 0; cl < pop.size(); cl++)
+			if (pop.act(cl) == act)
+				set.push_back(pop.get(cl));
+		for (bool merged = true; merged;) {
+			merged = false;
+			for (size_t i = 0; i < set.size(); i++)
+				for (size_t j = i + 1; j < set.size(); j++) {
+					if (set[i].experience < MIN_EXP || set[j].experience < MIN_EXP ||
+					    !in_window(set[i].prediction, set[j].prediction))
+						continue;
+					Classifier star;
+					star.rule.act = act;
+					for (size_t k = 0; k < set[i].rule.elements.size(); k += 2) {
+						star.rule.elements.push_back(std::min(set[i].rule.elements[k], set[j].rule.elements[k]));
+						star.rule.elements.push_back(std::max(set[i].rule.elements[k + 1], set[j].rule.elements[k + 1]));
+					}
+					const double prediction = (set[i].prediction * set[i].numerosity + set[j].prediction * set[j].numerosity) /
+					                          (set[i].numerosity + set[j].numerosity);
+					bool disproved = false;
+					for (size_t d = 0; d < set.size() && !disproved; d++) {
+						if (d == i || d == j || set[d].experience == 0 || in_window(prediction, set[d].prediction))
+							continue;
+						disproved = true;
+						for (size_t k = 0; k < star.rule.elements.size(); k += 2)
+							disproved &= set[d].rule.elements[k] <= star.rule.elements[k + 1] &&
+							             star.rule.elements[k] <= set[d].rule.elements[k + 1];
+					}
+					if (disproved)
+						continue;
+
+					star.experience = set[i].experience + set[j].experience;
+					star.numerosity = set[i].numerosity + set[j].numerosity;
+					star.prediction = prediction * star.numerosity;
+					vector<Classifier> kept;
+					for (size_t d = set.size(); d-- > 0;) {
+						bool subsumed = d != i && d != j;
+						for (size_t k = 0; k < star.rule.elements.size() && subsumed; k += 2)
+							subsumed = star.rule.elements[k] <= set[d].rule.elements[k] &&
+							           set[d].rule.elements[k + 1] <= star.rule.elements[k + 1];
+						if (subsumed && (in_window(prediction, set[d].prediction) || set[d].experience == 0)) {
+							if (set[d].experience > 0) {
+								star.experience += set[d].experience;
+								star.numerosity += set[d].numerosity;
+								star.prediction += set[d].prediction * set[d].numerosity;
+							}
+						} else if (d != i && d != j) {
+							kept.insert(kept.begin(), set[d]);
+						}
+					}
+					star.prediction /= star.numerosity;
+					const double exp_lim = 1 / BETA;
+					star.prediction_error =
+					    (star.experience <= floor(exp_lim))
+					        ? std::abs(star.prediction - PREDICTION_INIT) / star.experience
+					        : (std::abs(star.prediction - PREDICTION_INIT) / exp_lim) *
+					              beta_decay(star.experience - (unsigned int) floor(exp_lim));
+					star.fitness = (FITNESS_INIT - 1) * beta_decay(star.experience) + 1;
+					// a classifier with the same rule only gains numerosity
+					auto same = std::find_if(kept.begin(), kept.end(), [&](const Classifier& cl) { return cl.rule == star.rule; });
+					if (same != kept.end())
+						same->numerosity++;
+					else
+						kept.push_back(star);
+					set = kept;
+					merged = true;
+					j = i;
+				}
+		}
+		result.insert(result.end(), set.begin(), set.end());
+	}
+	return result;
+}
+
+/// The classifiers in a canonical order
+vector<Classifier>
+canonical(vector<Classifier> classifiers) {
+	std::sort(classifiers.begin(), classifiers.end(), [](const Classifier& a, const Classifier& b) {
+		return std::tie(a.rule.act, a.prediction, a.rule.elements, a.numerosity, a.experience) <
+		       std::tie(b.rule.act, b.prediction, b.rule.elements, b.numerosity, b.experience);
+	});
+	return classifiers;
+}
+
+/// The classifiers of pop in a canonical order
+vector<Classifier>
+canonical(const Population& pop) {
+	vector<Classifier> classifiers;
+	for (size_t cl = 0; cl < pop.size(); cl++)
+		classifiers.push_back(pop.get(cl));
+	return canonical(classifiers);
+}
+
+TEST_CASE( "combining differs from repeated passes only in the order of the merges", "[combine]" ) {
+	// Repeated passes reach the pairs a merge has changed in the next pass,
+	// the worklist right after the merge. Where merges do not interact both
+	// end alike. Otherwise later merges can take other pairs first and end
+	// elsewhere, but both stop where no pair is left to merge.
+	std::mt19937 gen(31);
+	for (int round = 0; round < 300; round++) {
+		Population pop;
+		pop.set_binary(true);
+		for (int c = 0; c < 16; c++) {
+			Classifier cl = random_binary_classifier(5, gen);
+			cl.experience = 1 + gen() % 5;
+			cl.numerosity = 1 + gen() % 3;
+			cl.prediction = (gen() % 8) * 4;
+			pop.push_back(cl);
+		}
+		const vector<Classifier> passes = canonical(combine_in_passes({0, 1}, pop));
+		combine_set({0, 1}, pop, 1);
+		REQUIRE(canonical(pop) == passes);
+	}
+
+	for (bool binary : {true, false}) {
+		xcs_rc::XCSLearner learner({0, 1}, 7);
+		learner.combining_period = 1000000;
+		learner.set_maxpopsize(400);
+		std::mt19937 gen(5);
+		run_multiplexer6(learner, 2000, gen, binary ? StateForm::String : StateForm::Real);
+
+		Population pop = learner.get_population();
+		Population reference;
+		reference.set_binary(binary);
+		for (const Classifier& cl : combine_in_passes({0, 1}, pop))
+			reference.push_back(cl);
+		combine_set({0, 1}, pop, 1);
+		require_no_pair_left(reference);
+		require_no_pair_left(pop);
+		INFO("repeated passes leave " << reference.size() << ", the worklist " << pop.size());
+		REQUIRE(std::abs((double) pop.size() - reference.size()) <= reference.size() / 20.0);
+		// the real valued merges interact
+		REQUIRE((canonical(pop) == canonical(reference)) == binary);
+	}
+}
+
+TEST_CASE( "incremental combining merges like a full pass", "[combine]" ) {
+	for (bool binary : {true, false}) {
+		xcs_rc::XCSLearner full({0, 1}, 5);
+		xcs_rc::XCSLearner incremental({0, 1}, 5);
+		full.set_incremental_combining(false);
+		for (xcs_rc::XCSLearner* learner : {&full, &incremental}) {
+			std::mt19937 gen(3);
+			learner->combining_period = 40;
+			learner->set_maxpopsize(400);
+			run_multiplexer6(*learner, 3000, gen, binary ? StateForm::String : StateForm::Real);
+		}
+		const Population& a = full.get_population();
+		const Population& b = incremental.get_population();
+		REQUIRE(a.size() == b.size());
+		for (size_t i = 0; i < a.size(); i++) {
+			REQUIRE(a.get(i) == b.get(i));
+			REQUIRE(a.disproving(i) == b.disproving(i));
+		}
+	}
+}
+
+TEST_CASE( "disproval cache follows erased, moved and inserted classifiers", "[combine]" ) {
+	std::mt19937 gen(17);
+	Population pop;
+	pop.set_binary(true);
+	for (int c = 0; c < 40; c++)
+		pop.push_back(random_binary_classifier(8, gen));
+	const uint64_t first = pop.id(0), second = pop.id(1);
+	ClassifierSet disprovers;
+	for (size_t cl = 2; cl < pop.size(); cl += 3)
+		disprovers.push_back(cl);
+	std::set<uint64_t> left, inserted;
+	for (size_t cl : disprovers)
+		left.insert(pop.id(cl));
+
+	DisprovalCache cache;
+	cache.begin(pop);
+	cache.store(pop, 0, 1, disprovers);
+	// more classifiers are inserted than erased, so that the ids outgrow the table
+	for (int round = 0; round < 150; round++) {
+		// erase the way combining does, keeping the pair
+		const size_t victim = 2 + gen() % (pop.size() - 2);
+		left.erase(pop.id(victim));
+		inserted.erase(pop.id(victim));
+		cache.erase(pop.id(victim));
+		pop.swap_erase(victim);
+		if (victim < pop.size())
+			cache.place(pop, victim);
+		for (int k = 0; k < 2; k++) {
+			const size_t cl = pop.push_back(random_binary_classifier(8, gen));
+			inserted.insert(pop.id(cl));
+			cache.place(pop, cl);
+		}
+
+		size_t i = pop.size(), j = pop.size();
+		for (size_t cl = 0; cl < pop.size(); cl++) {
+			if (pop.id(cl) == first) i = cl;
+			if (pop.id(cl) == second) j = cl;
+		}
+		ClassifierSet known, changed;
+		REQUIRE(cache.lookup(pop, i, j, known, changed));
+		std::set<uint64_t> known_ids, changed_ids;
+		for (size_t cl : known)
+			known_ids.insert(pop.id(cl));
+		for (size_t cl : changed)
+			changed_ids.insert(pop.id(cl));
+		REQUIRE(known.size() == left.size());
+		REQUIRE(known_ids == left);
+		REQUIRE(changed.size() == inserted.size());
+		REQUIRE(changed_ids == inserted);
+	}
+	cache.end();
+	REQUIRE(cache.size() == 1);
+}
+
+TEST_CASE( "reconciling keeps the changes made while combining", "[combine]" ) {
+	std::mt19937 gen(3);
+	xcs_rc::XCSLearner learner({0, 1});
+	learner.combining_period = 100000;
+	learner.set_maxpopsize(400);
+	run_multiplexer6(learner, 200, gen);
+
+	const Population snapshot = learner.get_population();
+	Population combined = snapshot;
+	sort_population(combined);
+	combine_set({0, 1}, combined, 1);
+
+	// a merged parent, a survivor and a survivor that live learning deletes
+	size_t parent = snapshot.size(), survivor = snapshot.size(), victim = snapshot.size();
+	for (size_t s = 0; s < snapshot.size(); s++) {
+		bool kept = false;
+		for (size_t c = 0; c < combined.size(); c++)
+			kept |= combined.id(c) == snapshot.id(s) && combined.numerosity(c) == snapshot.numerosity(s);
+		if (!kept && snapshot.experience(s) >= MIN_EXP)
+			parent = s;
+		else if (kept && survivor == snapshot.size())
+			survivor = s;
+		else if (kept)
+			victim = s;
+	}
+	REQUIRE(parent < snapshot.size());
+	REQUIRE(victim < snapshot.size());
+
+	Population live = snapshot;
+	live.set_numerosity(parent, live.numerosity(parent) + 2);
+	live.set_prediction(survivor, 123);
+	const size_t victim_numerosity = live.numerosity(victim);
+	const uint64_t victim_id = live.id(victim);
+	live.erase(victim);
+	const size_t born = live.push_back(transform_input("010011"), 1);
+	const uint64_t born_id = live.id(born);
+
+	const size_t total = combined.total_numerosity();
+	reconcile_combined(snapshot, live, combined);
+	require_totals_match_scan(combined);
+	REQUIRE(combined.total_numerosity() == total + 2 - victim_numerosity + 1);
+	bool found_born = false;
+	for (size_t c = 0; c < combined.size(); c++) {
+		REQUIRE(combined.id(c) != victim_id);
+		found_born |= combined.id(c) == born_id;
+		if (combined.id(c) == snapshot.id(survivor))
+			REQUIRE(combined.prediction(c) == 123);
+	}
+	REQUIRE(found_born);
+}
+
+TEST_CASE( "background combining leaves a consistent population", "[combine]" ) {
+	std::mt19937 gen(3);
+	xcs_rc::XCSLearner learner({0, 1}, 9);
+	learner.combining_period = 40;
+	learner.set_maxpopsize(200);
+	learner.set_background_combining(true);
+	run_multiplexer6(learner, 2000, gen);
+	// publishes the pass still running
+	learner.set_background_combining(false);
+
+	const Population& pop = learner.get_population();
+	require_totals_match_scan(pop);
+	std::set<uint64_t> ids;
+	for (size_t i = 0; i < pop.size(); i++) {
+		REQUIRE(pop.numerosity(i) > 0);
+		REQUIRE(ids.insert(pop.id(i)).second);
+	}
+	run_multiplexer6(learner, 100, gen);
+}
+
+TEST_CASE( "combining in slices merges like combining at once", "[combine]" ) {
+	std::mt19937 gen(3);
+	xcs_rc::XCSLearner learner({0, 1});
+	learner.combining_period = 100000;
+	learner.set_maxpopsize(400);
+	run_multiplexer6(learner, 1500, gen);
+
+	Population whole = learner.get_population();
+	combine_set({0, 1}, whole, 1);
+	for (size_t budget : {1, 7}) {
+		Population sliced = learner.get_population();
+		CombiningPass pass;
+		size_t slices = 1;
+		while (!combine_set({0, 1}, sliced, pass, budget))
+			slices++;
+		REQUIRE(slices > 10);
+		REQUIRE(sliced.size() == whole.size());
+		for (size_t i = 0; i < whole.size(); i++) {
+			REQUIRE(sliced.get(i) == whole.get(i));
+			REQUIRE(sliced.disproving(i) == whole.disproving(i));
+		}
+	}
+}
+
+TEST_CASE( "budgeted combining is reproducible", "[combine]" ) {
+	xcs_rc::XCSLearner first({0, 1}, 9);
+	xcs_rc::XCSLearner second({0, 1}, 9);
+	for (xcs_rc::XCSLearner* learner : {&first, &second}) {
+		std::mt19937 gen(3);
+		learner->combining_period = 40;
+		learner->set_maxpopsize(200);
+		learner->set_combining_budget(20);
+		run_multiplexer6(*learner, 2000, gen);
+	}
+	const Population& a = first.get_population();
+	const Population& b = second.get_population();
+	require_totals_match_scan(a);
+	REQUIRE(a.size() == b.size());
+	for (size_t i = 0; i < a.size(); i++)
+		REQUIRE(a.get(i) == b.get(i));
+}
+
+TEST_CASE( "combining trigger follows the yield of the passes", "[combine]" ) {
+	CombiningTrigger trigger;
+	trigger.min_interval = 10;
+	trigger.max_interval = 40;
+	trigger.burst = 8;
+	Population pop;
+	trigger.started(pop, 2, 0);
+	REQUIRE(!trigger.due(pop, 100, 9));
+	REQUIRE(trigger.due(pop, 100, 10));
+
+	// passes that merge nothing come less and less often
+	trigger.finished(50, 50);
+	REQUIRE(!trigger.due(pop, 100, 19));
+	REQUIRE(trigger.due(pop, 100, 20));
+	trigger.started(pop, 2, 20);
+	trigger.finished(50, 50);
+	trigger.finished(50, 50);
+	REQUIRE(!trigger.due(pop, 100, 59));
+	REQUIRE(trigger.due(pop, 100, 60));
+
+	// classifiers reaching MIN_EXP make a pass due early
+	trigger.experienced(7);
+	REQUIRE(!trigger.due(pop, 100, 30));
+	trigger.experienced(1);
+	REQUIRE(!trigger.due(pop, 100, 29));
+	REQUIRE(trigger.due(pop, 100, 30));
+
+	// a pass with a good yield brings the next one closer
+	trigger.started(pop, 2, 60);
+	trigger.finished(50, 45);
+	REQUIRE(!trigger.due(pop, 100, 79));
+	REQUIRE(trigger.due(pop, 100, 80));
+}
+
+TEST_CASE( "combining trigger reacts to room and cost", "[combine]" ) {
+	std::mt19937 gen(5);
+	Population pop;
+	for (size_t c = 0; c < 20; c++) {
+		Classifier cl = random_binary_classifier(6, gen);
+		cl.numerosity = 4;
+		cl.experience = 1;
+		pop.push_back(cl);
+	}
+
+	CombiningTrigger trigger;
+	trigger.min_interval = 10;
+	trigger.max_interval = 1000;
+	trigger.burst = 8;
+	trigger.started(pop, 2, 0);
+	trigger.finished(50, 50);
+
+	// a population close to its limit takes fewer classifiers
+	trigger.experienced(2);
+	REQUIRE(!trigger.due(pop, 160, 10));
+	REQUIRE(trigger.due(pop, 100, 10));
+
+	// 20 experienced classifiers over 2 actions cost about 100 pairs
+	trigger.pairs_per_trial = 5;
+	REQUIRE(!trigger.due(pop, 100, 19));
+	REQUIRE(trigger.due(pop, 100, 20));
+}
+
+TEST_CASE( "combining stops where no pair is left to merge", "[combine]" ) {
+	const ActionSpace actions = {0, 1};
+	for (bool binary : {true, false}) {
+		xcs_rc::XCSLearner learner(actions, 5);
+		learner.combining_period = 1000000;
+		learner.set_maxpopsize(400);
+		std::mt19937 gen(3);
+		run_multiplexer6(learner, 2000, gen, binary ? StateForm::String : StateForm::Real);
+
+		Population once = learner.get_population();
+		REQUIRE(once.binary() == binary);
+		combine_set(actions, once, 1);
+		REQUIRE(once.size() < learner.get_population().size());
+		Population twice = once;
+		combine_set(actions, twice, 1);
+		// merging would have added classifiers with new ids
+		std::set<uint64_t> ids;
+		for (size_t cl = 0; cl < once.size(); cl++)
+			ids.insert(once.id(cl));
+		for (size_t cl = 0; cl < twice.size(); cl++)
+			REQUIRE(ids.count(twice.id(cl)) == 1);
+	}
+}
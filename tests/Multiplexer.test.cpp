@@ -26,20 +26,22 @@ using PerformanceResult = std::vector<TestRow>;
 
 struct TestResult {
 	PerformanceResult performance;
-	ClassifierSet population;
+	Population population;
 };
 
 bool
-save_population(const ClassifierSet& pop, const char* filename);
+save_population(const Population& pop, const char* filename);
 
 TestResult
-test_multiplexer(unsigned address_bits, int inputMode, unsigned int debugMode) {
+test_multiplexer(unsigned address_bits, int inputMode, unsigned int debugMode, unsigned sim) {
 	TestResult result;
 	int inputLength = address_bits + pow(2, address_bits);
 	unsigned correct = 0;
 
 	ActionSpace actions = {0, 1};
-	XCSLearner learner(actions);
+	// the learner and the environment draw from separate generators, one stream per simulation
+	XCSLearner learner(actions, 0, sim);
+	Rng environment(1, sim);
 
 	int binary_tcombs[] = { 0, 40, 100, 200, 500, 1000 };
 	int binary_popsizes[] = { 0, 100, 400, 800, 1000, 2000 };
@@ -55,8 +57,8 @@ test_multiplexer(unsigned address_bits, int inputMode, unsigned int debugMode) {
 
 	learner.combining_period = T_COMB;
 	learner.set_maxpopsize(MAXPOPSIZE);
+	learner.set_match_index(inputMode == 0);
 
-	srand(0);
 	for (size_t trials = 1; trials <= NUM_OF_TRIALS; trials++) {
 		const ActionMode amode = (trials % 2 == 0) ? ActionMode::Explore : ActionMode::Exploit;
 
@@ -65,7 +67,7 @@ test_multiplexer(unsigned address_bits, int inputMode, unsigned int debugMode) {
 		std::string binaryState = "";
 
 		for (int i=0; i<inputLength; i++) {
-			double num = round(1000 * random_number(0, 1)) / 1000;
+			double num = round(1000 * environment.uniform(0, 1)) / 1000;
 			binaryState += std::to_string((int)round(num));
 
 			if (inputMode == 1) {
@@ -101,24 +103,23 @@ test_multiplexer(unsigned address_bits, int inputMode, unsigned int debugMode) {
 		}
 
 		// RECORD WITH T_COMB SLIDING WINDOW
-		const auto pop = learner.get_population();
+		const auto& pop = learner.get_population();
 		if (trials % T_COMB == 0) {
-			for (auto& c : pop) {
-				if (c->numerosity == 0) std::cout << "Num 0: " << c->cond << ":" << c->rule.act << "->" << c->prediction << "; Num: " << c->numerosity << "; Exp: " << c->experience << "; Fit: " << c->fitness << std::endl;
+			for (size_t c = 0; c < pop.size(); c++) {
+				if (pop.numerosity(c) == 0) std::cout << "Num 0: " << pop.get(c) << std::endl;
 			}
 
-			clexp exps = get_exp_classifiers(pop);
 			double correctness_rate = (double)correct / (T_COMB / 2);
 
 			if (debugMode>0) {
-				std::cout << "Trial: " << trials << "; Perf: " << correctness_rate << "; Popsize: " << learner.get_population().size() << "; ExpCl: " << exps.cl_exp << "; TotExp: " << exps.tot_exp << std::endl;
+				std::cout << "Trial: " << trials << "; Perf: " << correctness_rate << "; Popsize: " << learner.get_population().size() << "; ExpCl: " << learner.experienced_classifiers() << "; TotExp: " << learner.total_experience() << std::endl;
 				if (debugMode>1) {
 					print_pop(pop, true);
 					std::cout << std::endl;
 				}
 			}
 
-			result.performance.push_back(TestRow{learner.trials, correctness_rate, (size_t) pop.size(), exps.cl_exp});
+			result.performance.push_back(TestRow{learner.trials, correctness_rate, (size_t) pop.size(), learner.experienced_classifiers()});
 			correct = 0;
 
 			const size_t buflen = 100;
@@ -154,7 +155,7 @@ save_performance(const PerformanceResult& result, const char* filename) {
 }
 
 bool
-save_population(const ClassifierSet& pop, const char* filename) {
+save_population(const Population& pop, const char* filename) {
 	std::ofstream file;
 
 	file.open(filename);
@@ -166,13 +167,13 @@ save_population(const ClassifierSet& pop, const char* filename) {
 	file << "sep=;" << std::endl;
 	file << "No;Cond;Act;Pred;Fit;PredErr;Num;Exp" << std::endl;
 	size_t i = 0;
-	for (auto& cl : pop) {
-		if (cl->experience > 0)
-			file << ++i << ";" << *cl << std::endl;
+	for (size_t cl = 0; cl < pop.size(); cl++) {
+		if (pop.experience(cl) > 0)
+			file << ++i << ";" << pop.get(cl) << std::endl;
 	}
-	for (auto& cl : pop) {
-		if (cl->experience == 0)
-			file << ++i << ";" << *cl << std::endl;
+	for (size_t cl = 0; cl < pop.size(); cl++) {
+		if (pop.experience(cl) == 0)
+			file << ++i << ";" << pop.get(cl) << std::endl;
 	}
 
 	file.close();
@@ -232,7 +233,7 @@ int main() {
 
 	std::vector<TestResult> results;
 	for (size_t i=0; i<SIMULATIONS; i++) {
-		results.push_back(test_multiplexer(ADDRESS_BITS, inputMode, debugMode));
+		results.push_back(test_multiplexer(ADDRESS_BITS, inputMode, debugMode, i));
 
 		std::cout << "SIM " << (i+1) << " COMPLETED" << std::endl;
 		if (debugMode>1) {